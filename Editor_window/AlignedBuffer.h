@@ -0,0 +1,71 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Owning, over-aligned array of trivial elements. Used for pixel and vertex
+// storage that the SIMD paths load with aligned instructions.
+template <typename T, std::size_t Alignment = 32>
+class AlignedBuffer {
+    static_assert(std::is_trivially_copyable<T>::value, "AlignedBuffer holds trivial element types only");
+    static_assert((Alignment & (Alignment - 1)) == 0, "Alignment must be a power of two");
+
+public:
+    AlignedBuffer() = default;
+
+    explicit AlignedBuffer(std::size_t count) {
+        allocate(count);
+    }
+
+    ~AlignedBuffer() {
+        release();
+    }
+
+    AlignedBuffer(const AlignedBuffer&) = delete;
+    AlignedBuffer& operator=(const AlignedBuffer&) = delete;
+
+    AlignedBuffer(AlignedBuffer&& other) noexcept
+        : ptr(other.ptr), count(other.count) {
+        other.ptr = nullptr;
+        other.count = 0;
+    }
+
+    AlignedBuffer& operator=(AlignedBuffer&& other) noexcept {
+        if (this != &other) {
+            release();
+            ptr = other.ptr;
+            count = other.count;
+            other.ptr = nullptr;
+            other.count = 0;
+        }
+        return *this;
+    }
+
+    void allocate(std::size_t newCount) {
+        release();
+        if (newCount == 0) return;
+        ptr = static_cast<T*>(::operator new(newCount * sizeof(T), std::align_val_t(Alignment)));
+        count = newCount;
+    }
+
+    void release() {
+        if (ptr) {
+            ::operator delete(ptr, std::align_val_t(Alignment));
+            ptr = nullptr;
+            count = 0;
+        }
+    }
+
+    T* get() { return ptr; }
+    const T* get() const { return ptr; }
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    T& operator[](std::size_t i) { return ptr[i]; }
+    const T& operator[](std::size_t i) const { return ptr[i]; }
+
+private:
+    T* ptr = nullptr;
+    std::size_t count = 0;
+};
@@ -0,0 +1,518 @@
+// Benchmark.cpp : headless render loop used for perf runs and PGO training.
+//
+// Usage: Benchmark [--help] [--width N] [--height N] [--frames N] [--objects N] [--steps N]
+//                  [--threads N] [--pin 0|1] [--scaling 0|1] [--kernels 0|1] [--math 0|1]
+//                  [--simd scalar|sse|avx2|avx512|neon] [--fill solid|wireframe] [--aa 0|1]
+//                  [--msaa 1|4|8] [--tile N] [--animate all|one|none] [--realtime S] [--cap HZ]
+//                  [--pipeline 1-4] [--trace file.json] [--output file.ppm]
+//
+// --threads counts every thread that renders, including the caller; the default
+// uses all cores. --scaling reruns the scene with 1..N threads and prints the
+// speedup over the single-threaded run. --kernels times the SoA vertex kernels
+// on one --steps sphere at every SIMD level the CPU supports. --math times the
+// old per-corner rotate-then-project path against one MVP matrix per corner;
+// EngineTests checks that both land on the same pixels.
+// --aa draws wireframe lines anti-aliased; --msaa sets the samples per pixel of solid fills.
+// --tile sets the edge length of the screen tiles rasterized in parallel.
+// --animate picks what moves: the orbiting camera and every object (all), only
+// the first object (one), or nothing (none), the last two being the mostly
+// static views dirty-region tracking is for.
+// --realtime runs the scene for S seconds of wall time on the engine's
+// fixed-step loop instead of one step per frame: the animation advances at
+// 60 steps a second and frames render as fast as they can, or at most --cap
+// per second. It reports throughput and frame pacing.
+// --pipeline sets how many frames may be in flight: 1 simulates and renders
+// each frame in turn, 2 or more simulate the next frame on a separate thread
+// while the current one renders. Frame latency is reported either way.
+// --trace profiles every frame stage, writes a Chrome trace (about:tracing or
+// Perfetto) to the file and prints frame and stage time percentiles.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "FrameLoop.h"
+#include "FramePipeline.h"
+#include "HeadlessPresenter.h"
+#include "Profiler.h"
+#include "Renderer.h"
+#include "VertexKernels.h"
+
+struct BenchmarkOptions {
+    int width = 1920;
+    int height = 1080;
+    int frames = 300;
+    int objects = 8;
+    int steps = 100;
+    int threads = 0;
+    bool pin = false;
+    bool scaling = false;
+    bool kernels = false;
+    bool math = false;
+    FillMode fill = FillMode::Solid;
+    bool antialias = false;
+    int samples = 1;
+    int tileSize = Renderer::DefaultTileSize;
+    enum class Animation { All, One, None } animation = Animation::All;
+    double realtime = 0;
+    double frameRateLimit = 0;
+    int pipelineDepth = 1;
+    std::string trace;
+    std::string output;
+    bool help = false;
+};
+
+static const SimdLevel AllSimdLevels[] = { SimdLevel::Scalar, SimdLevel::SSE, SimdLevel::AVX2, SimdLevel::AVX512, SimdLevel::NEON };
+
+static void PrintUsage(std::ostream& out) {
+    out << "Usage: Benchmark [options]\n"
+        << "  --width N, --height N     framebuffer size (1920x1080)\n"
+        << "  --frames N                frames to render (300)\n"
+        << "  --objects N               spheres in the scene (8)\n"
+        << "  --steps N                 sphere tessellation steps (100)\n"
+        << "  --threads N               rendering threads including the caller, 0 for all cores (0)\n"
+        << "  --pin 0|1                 pin pool workers to cores (0)\n"
+        << "  --scaling 0|1             rerun with 1..N threads and print the speedup (0)\n"
+        << "  --kernels 0|1             time the SoA vertex kernels at every SIMD level (0)\n"
+        << "  --math 0|1                time per-corner rotate-then-project against one MVP (0)\n"
+        << "  --simd LEVEL              scalar, sse, avx2, avx512 or neon (best supported)\n"
+        << "  --fill solid|wireframe    fill mode (solid)\n"
+        << "  --aa 0|1                  anti-aliased wireframe lines (0)\n"
+        << "  --msaa 1|4|8              samples per pixel of solid fills (1)\n"
+        << "  --tile N                  tile edge length, a multiple of " << Framebuffer::CoarseBlockSize
+        << " up to " << Renderer::MaxTileSize << " (" << Renderer::DefaultTileSize << ")\n"
+        << "  --animate all|one|none    what moves between frames (all)\n"
+        << "  --realtime S              run the fixed-step loop for S seconds of wall time (0)\n"
+        << "  --cap HZ                  with --realtime, render at most HZ frames a second (0)\n"
+        << "  --pipeline 1-" << FramePipeline::MaxDepth << "            frames in flight (1)\n"
+        << "  --trace FILE              profile frame stages and write a Chrome trace\n"
+        << "  --output FILE             write every presented frame to FILE as a PPM image\n"
+        << "  --help, -h                print this help" << std::endl;
+}
+
+static bool ParseOptions(int argc, char** argv, BenchmarkOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (!strcmp(arg, "--help") || !strcmp(arg, "-h")) {
+            options.help = true;
+            return true;
+        }
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return false;
+        }
+
+        if (!strcmp(arg, "--width")) options.width = atoi(value);
+        else if (!strcmp(arg, "--height")) options.height = atoi(value);
+        else if (!strcmp(arg, "--frames")) options.frames = atoi(value);
+        else if (!strcmp(arg, "--objects")) options.objects = atoi(value);
+        else if (!strcmp(arg, "--steps")) options.steps = atoi(value);
+        else if (!strcmp(arg, "--threads")) options.threads = atoi(value);
+        else if (!strcmp(arg, "--pin")) options.pin = atoi(value) != 0;
+        else if (!strcmp(arg, "--scaling")) options.scaling = atoi(value) != 0;
+        else if (!strcmp(arg, "--kernels")) options.kernels = atoi(value) != 0;
+        else if (!strcmp(arg, "--math")) options.math = atoi(value) != 0;
+        else if (!strcmp(arg, "--simd")) {
+            bool found = false;
+            for (SimdLevel level : AllSimdLevels) {
+                if (!strcmp(value, GetSimdLevelName(level))) {
+                    found = SetSimdLevel(level);
+                    if (!found) std::cerr << "This CPU does not support " << value << std::endl;
+                    break;
+                }
+            }
+            if (!found) return false;
+        }
+        else if (!strcmp(arg, "--fill")) {
+            if (!strcmp(value, "solid")) options.fill = FillMode::Solid;
+            else if (!strcmp(value, "wireframe")) options.fill = FillMode::Wireframe;
+            else {
+                std::cerr << "Unknown fill mode " << value << std::endl;
+                return false;
+            }
+        }
+        else if (!strcmp(arg, "--aa")) options.antialias = atoi(value) != 0;
+        else if (!strcmp(arg, "--msaa")) {
+            options.samples = atoi(value);
+            if (!Renderer::isValidSampleCount(options.samples)) {
+                std::cerr << "Unsupported sample count " << value << std::endl;
+                return false;
+            }
+        }
+        else if (!strcmp(arg, "--tile")) {
+            options.tileSize = atoi(value);
+            if (!Renderer::isValidTileSize(options.tileSize)) {
+                std::cerr << "Tile size must be a multiple of " << Framebuffer::CoarseBlockSize << " up to " << Renderer::MaxTileSize << std::endl;
+                return false;
+            }
+        }
+        else if (!strcmp(arg, "--animate")) {
+            if (!strcmp(value, "all")) options.animation = BenchmarkOptions::Animation::All;
+            else if (!strcmp(value, "one")) options.animation = BenchmarkOptions::Animation::One;
+            else if (!strcmp(value, "none")) options.animation = BenchmarkOptions::Animation::None;
+            else {
+                std::cerr << "Unknown animation " << value << std::endl;
+                return false;
+            }
+        }
+        else if (!strcmp(arg, "--realtime")) options.realtime = atof(value);
+        else if (!strcmp(arg, "--cap")) options.frameRateLimit = atof(value);
+        else if (!strcmp(arg, "--pipeline")) {
+            options.pipelineDepth = atoi(value);
+            if (options.pipelineDepth < 1 || options.pipelineDepth > FramePipeline::MaxDepth) {
+                std::cerr << "Pipeline depth must be 1 to " << FramePipeline::MaxDepth << std::endl;
+                return false;
+            }
+        }
+        else if (!strcmp(arg, "--trace")) options.trace = value;
+        else if (!strcmp(arg, "--output")) options.output = value;
+        else {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return false;
+        }
+        ++i;
+    }
+    return options.width > 0 && options.height > 0 && options.frames > 0 && options.threads >= 0 && options.realtime >= 0 && options.frameRateLimit >= 0;
+}
+
+// Applies the render options and adds the benchmark's spheres.
+static void SetUpScene(const BenchmarkOptions& options, Renderer& renderer, std::vector<std::unique_ptr<Sphere>>& spheres) {
+    renderer.setFillMode(options.fill);
+    renderer.setLineAntialiasing(options.antialias);
+    renderer.setTileSize(options.tileSize);
+    renderer.setMultisampling(options.samples);
+    for (int i = 0; i < options.objects; ++i) {
+        spheres.push_back(std::make_unique<Sphere>(50.0f + 10.0f * (i % 32), options.steps, options.steps));
+        renderer.addObject(spheres.back().get());
+    }
+}
+
+// Advances whatever --animate moves by one simulation step; `step` counts from 0.
+static void StepScene(const BenchmarkOptions& options, Renderer& renderer, std::vector<std::unique_ptr<Sphere>>& spheres, long long step) {
+    if (options.animation == BenchmarkOptions::Animation::All) {
+        renderer.update();
+    } else if (options.animation == BenchmarkOptions::Animation::One && !spheres.empty()) {
+        float angle = 0.01f * (step + 1);
+        spheres[0]->rotate(angle, angle, angle);
+    }
+}
+
+static void PrintPipeline(int depth, const PipelineStats& stats) {
+    std::cout << std::fixed << std::setprecision(2)
+              << "pipeline:   depth " << depth << ", latency " << stats.getAverageLatency() * 1000.0 << " ms mean, "
+              << stats.maxLatency * 1000.0 << " ms max; waited " << stats.renderWait * 1000.0 << " ms for simulation, "
+              << stats.simulationWait * 1000.0 << " ms for rendering\n";
+}
+
+// Renders the benchmark scene with `threads` rendering threads and returns the elapsed seconds.
+// The counters of the last frame and the pipeline's are copied out when asked for.
+static double RunScene(const BenchmarkOptions& options, unsigned threads, HeadlessPresenter& presenter,
+    RenderStats* lastFrame = nullptr, PipelineStats* pipelineStats = nullptr) {
+    unsigned workers = threads == 0 ? ThreadPool::AutoWorkerCount : threads - 1;
+    Renderer renderer(options.width, options.height, workers, options.pin);
+    std::vector<std::unique_ptr<Sphere>> spheres;
+    SetUpScene(options, renderer, spheres);
+
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point start = Clock::now();
+    long long step = 0;
+    FramePipeline pipeline(renderer, [&](FrameSnapshot& snapshot) {
+        StepScene(options, renderer, spheres, step++);
+        renderer.capture(snapshot);
+    }, options.pipelineDepth);
+    for (int frame = 0; frame < options.frames; ++frame) {
+        pipeline.renderFrame([&](Renderer& drawn) { drawn.present(presenter); });
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    if (lastFrame) *lastFrame = renderer.getStats();
+    if (pipelineStats) *pipelineStats = pipeline.getStats();
+    return seconds;
+}
+
+// Runs the scene on a FrameLoop for options.realtime seconds of wall time and
+// prints the frame rate, the simulation rate and how evenly frames were paced.
+static void RunRealtime(const BenchmarkOptions& options, HeadlessPresenter& presenter) {
+    unsigned workers = options.threads == 0 ? ThreadPool::AutoWorkerCount : options.threads - 1;
+    Renderer renderer(options.width, options.height, workers, options.pin);
+    std::vector<std::unique_ptr<Sphere>> spheres;
+    SetUpScene(options, renderer, spheres);
+
+    // The loop paces the simulation side; with a deeper pipeline that side
+    // runs on its own thread, so everything it measures lives there too.
+    FrameLoop loop(Renderer::SimulationStep);
+    loop.setFrameRateLimit(options.frameRateLimit);
+    long long frames = 0, simulatedFrames = 0, steps = 0;
+    double shortest = HUGE_VAL, longest = 0, sum = 0, sumSquares = 0;
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point start = Clock::now();
+    loop.reset();
+    double seconds = 0;
+    PipelineStats pipelineStats;
+    {
+        FramePipeline pipeline(renderer, [&](FrameSnapshot& snapshot) {
+            int due = loop.beginFrame();
+            // The first interval only measures setup.
+            if (simulatedFrames++ > 0) {
+                double frame = loop.getFrameSeconds();
+                shortest = std::min(shortest, frame);
+                longest = std::max(longest, frame);
+                sum += frame;
+                sumSquares += frame * frame;
+            }
+            for (int i = 0; i < due; ++i) {
+                StepScene(options, renderer, spheres, steps++);
+            }
+            renderer.capture(snapshot, loop.getAlpha());
+        }, options.pipelineDepth);
+        while (seconds < options.realtime) {
+            pipeline.renderFrame([&](Renderer& drawn) { drawn.present(presenter); });
+            ++frames;
+            seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        }
+        pipelineStats = pipeline.getStats();
+    }
+
+    long long intervals = std::max(1LL, simulatedFrames - 1);
+    double mean = sum / intervals;
+    double deviation = std::sqrt(std::max(0.0, sumSquares / intervals - mean * mean));
+    std::cout << std::fixed << std::setprecision(2)
+              << "loop:       " << (options.frameRateLimit > 0 ? "capped at " + std::to_string((int)options.frameRateLimit) + " fps" : std::string("uncapped"))
+              << ", " << seconds << " s\n"
+              << "frames:     " << frames << " (" << frames / seconds << " fps)\n"
+              << "steps:      " << steps << " (" << steps / seconds << " per second, fixed " << 1.0 / Renderer::SimulationStep << ")\n"
+              << "frame time: " << mean * 1000.0 << " ms mean, " << deviation * 1000.0 << " ms deviation, "
+              << (simulatedFrames > 1 ? shortest : 0.0) * 1000.0 << " - " << longest * 1000.0 << " ms range\n";
+    PrintPipeline(options.pipelineDepth, pipelineStats);
+}
+
+// With --trace, saves the trace and prints the frame and stage percentiles.
+static void WriteProfile(const BenchmarkOptions& options) {
+    if (options.trace.empty()) return;
+    if (!Profiler::writeChromeTrace(options.trace)) {
+        std::cerr << "Failed to write trace to " << options.trace << "." << std::endl;
+    }
+    Profiler::printSummary(std::cout);
+}
+
+// Times each vertex kernel on the vertices of one sphere and prints ns per vertex.
+static void RunKernelBenchmark(const BenchmarkOptions& options) {
+    Sphere sphere(100.0f, options.steps, options.steps);
+    const VertexStreams& source = sphere.getMesh().vertices;
+    size_t count = source.size();
+    VertexStreams work;
+    work.resize(count);
+    AlignedBuffer<float, VertexStreams::Alignment> outW(work.getPaddedSize());
+
+    const float rotation[9] = { 0.99995f, -0.00995f, 0.00005f, 0.00995f, 0.99990f, -0.00995f, 0.0f, 0.00995f, 0.99995f };
+    const float transform[16] = { 1, 0, 0, 5, 0, 1, 0, -3, 0, 0, 1, 2, 0, 0, 0.01f, 1 };
+    const ProjectionParams projection = { 960.0f, 540.0f, 560.0f, 16.0f / 9.0f, 0.0f, 0.0f };
+
+    std::cout << "vertices:   " << count << "\n"
+              << "level        rotate  transform    project   (ns/vertex)\n";
+    using Clock = std::chrono::steady_clock;
+    for (SimdLevel level : AllSimdLevels) {
+        if (!IsSimdLevelSupported(level)) continue;
+        const VertexKernels& kernels = GetVertexKernels(level);
+        double timings[3];
+        for (int kernel = 0; kernel < 3; ++kernel) {
+            std::memcpy(work.x.get(), source.x.get(), count * sizeof(float));
+            std::memcpy(work.y.get(), source.y.get(), count * sizeof(float));
+            std::memcpy(work.z.get(), source.z.get(), count * sizeof(float));
+
+            Clock::time_point start = Clock::now();
+            for (int frame = 0; frame < options.frames; ++frame) {
+                if (kernel == 0) kernels.rotate(rotation, work.x.get(), work.y.get(), work.z.get(), count);
+                else if (kernel == 1) kernels.transform(transform, source.x.get(), source.y.get(), source.z.get(), work.x.get(), work.y.get(), work.z.get(), outW.get(), count);
+                else kernels.project(projection, source.x.get(), source.y.get(), source.z.get(), work.x.get(), work.y.get(), count);
+            }
+            timings[kernel] = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / (double(count) * options.frames);
+        }
+        std::cout << std::left << std::setw(8) << GetSimdLevelName(level) << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(11) << timings[0] << std::setw(11) << timings[1] << std::setw(11) << timings[2] << std::endl;
+    }
+}
+
+// The pre-matrix path: three in-place axis rotations, then the hard-coded
+// perspective of the old vec3d::projectTo2D. Kept here as the reference.
+static vec3d LegacyRotateAndProject(vec3d v, const float* sinCos, float centerX, float centerY, float scale, float moveX, float moveY) {
+    float y = v.y * sinCos[1] - v.z * sinCos[0];
+    float z = v.y * sinCos[0] + v.z * sinCos[1];
+    v.y = y; v.z = z;
+    float x = v.x * sinCos[3] + v.z * sinCos[2];
+    z = -v.x * sinCos[2] + v.z * sinCos[3];
+    v.x = x; v.z = z;
+    x = v.x * sinCos[5] - v.y * sinCos[4];
+    y = v.x * sinCos[4] + v.y * sinCos[5];
+    v.x = x; v.y = y;
+
+    const float fov = 70.0f;
+    const float aspectRatio = 16.0f / 9.0f;
+    float projectedX = v.x / (1 + v.z / (fov * scale)) * aspectRatio;
+    float projectedY = v.y / (1 + v.z / (fov * scale)) * aspectRatio;
+    return vec3d(centerX + projectedX + moveX, centerY - projectedY + moveY, v.z);
+}
+
+// Times per-corner vertex processing over every triangle of one sphere, and the
+// matrix/quaternion building blocks themselves.
+static void RunMathBenchmark(const BenchmarkOptions& options) {
+    Sphere sphere(100.0f, options.steps, options.steps);
+    const Mesh& mesh = sphere.getMesh();
+    const VertexStreams& rest = mesh.vertices;
+    size_t corners = mesh.getTriangleCount() * 3;
+    const float angleX = 0.3f, angleY = 0.2f, angleZ = 0.1f;
+    const float sinCos[6] = { std::sin(angleX), std::cos(angleX), std::sin(angleY), std::cos(angleY), std::sin(angleZ), std::cos(angleZ) };
+    ProjectionParams params = { 960.0f, 540.0f, 560.0f, 16.0f / 9.0f, 40.0f, -25.0f };
+    mat4 mvp = mat4::screenProjection(params) * mat4::fromQuat(quat::fromEuler(angleX, angleY, angleZ));
+
+    using Clock = std::chrono::steady_clock;
+    volatile float sink = 0;
+
+    Clock::time_point start = Clock::now();
+    for (int frame = 0; frame < options.frames; ++frame) {
+        float sum = 0;
+        for (size_t t = 0; t < mesh.getTriangleCount(); ++t) {
+            uint32_t corner[3];
+            mesh.getTriangle(t, corner[0], corner[1], corner[2]);
+            for (uint32_t i : corner) {
+                vec3d v = LegacyRotateAndProject(vec3d(rest.x[i], rest.y[i], rest.z[i]), sinCos, 960.0f, 540.0f, 8.0f, 40.0f, -25.0f);
+                sum += v.x + v.y;
+            }
+        }
+        sink = sink + sum;
+    }
+    double legacy = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / (double(corners) * options.frames);
+
+    start = Clock::now();
+    for (int frame = 0; frame < options.frames; ++frame) {
+        float sum = 0;
+        for (size_t t = 0; t < mesh.getTriangleCount(); ++t) {
+            uint32_t corner[3];
+            mesh.getTriangle(t, corner[0], corner[1], corner[2]);
+            for (uint32_t i : corner) {
+                vec3d v = mvp.transformPoint(vec3d(rest.x[i], rest.y[i], rest.z[i])).project();
+                sum += v.x + v.y;
+            }
+        }
+        sink = sink + sum;
+    }
+    double combined = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / (double(corners) * options.frames);
+
+    const int iterations = 1000000;
+    mat4 accumulated = mat4::identity();
+    mat4 step = mat4::fromQuat(quat::fromEuler(0.001f, 0.002f, 0.003f));
+    start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        accumulated = accumulated * step;
+    }
+    double matMul = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations;
+    sink = sink + accumulated.m[0];
+
+    quat q;
+    start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        q = quat::fromEuler(i * 1e-6f, 0.2f, 0.1f);
+        sink = sink + mat4::fromQuat(q).m[5];
+    }
+    double quatToMat = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations;
+
+    std::cout << "corners:    " << corners << " (" << rest.size() << " unique vertices)\n"
+              << std::fixed << std::setprecision(3)
+              << "legacy rotate x3 + projectTo2D: " << std::setw(8) << legacy << " ns/corner\n"
+              << "mvp transform + divide:         " << std::setw(8) << combined << " ns/corner\n"
+              << "mat4 * mat4:                    " << std::setw(8) << matMul << " ns\n"
+              << "quat::fromEuler + fromQuat:     " << std::setw(8) << quatToMat << " ns" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    BenchmarkOptions options;
+    if (!ParseOptions(argc, argv, options)) {
+        PrintUsage(std::cerr);
+        return EXIT_FAILURE;
+    }
+    if (options.help) {
+        PrintUsage(std::cout);
+        return EXIT_SUCCESS;
+    }
+
+    Sphere sample(50.0f, options.steps, options.steps);
+    std::cout << "resolution: " << options.width << "x" << options.height << "\n"
+              << "objects:    " << options.objects << " (" << options.steps << "x" << options.steps << " steps, "
+              << sample.getMesh().getMemoryUsage() / 1024 << " KiB mesh each)\n"
+              << "frames:     " << options.frames << "\n";
+
+    if (options.math) {
+        RunMathBenchmark(options);
+        return EXIT_SUCCESS;
+    }
+
+    if (options.kernels) {
+        RunKernelBenchmark(options);
+        return EXIT_SUCCESS;
+    }
+
+    std::cout << "simd:       " << GetSimdLevelName(GetVertexKernels().level) << "\n";
+    if (!options.trace.empty()) {
+        Profiler::setThreadName("main");
+        Profiler::setEnabled(true);
+    }
+    if (options.realtime > 0) {
+        HeadlessPresenter presenter(options.output);
+        RunRealtime(options, presenter);
+        WriteProfile(options);
+        return EXIT_SUCCESS;
+    }
+    if (options.scaling) {
+        unsigned maxThreads = options.threads > 0 ? (unsigned)options.threads : std::max(1u, std::thread::hardware_concurrency());
+        double baseline = 0;
+        std::cout << "threads   ms/frame        fps    speedup\n";
+        for (unsigned threads = 1; threads <= maxThreads; ++threads) {
+            HeadlessPresenter presenter;
+            double seconds = RunScene(options, threads, presenter);
+            if (threads == 1) baseline = seconds;
+            std::cout << std::setw(7) << threads
+                      << std::setw(11) << std::fixed << std::setprecision(3) << seconds * 1000.0 / options.frames
+                      << std::setw(11) << std::setprecision(1) << options.frames / seconds
+                      << std::setw(10) << std::setprecision(2) << baseline / seconds << "x" << std::endl;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    HeadlessPresenter presenter(options.output);
+    RenderStats stats;
+    PipelineStats pipelineStats;
+    double seconds = RunScene(options, (unsigned)options.threads, presenter, &stats, &pipelineStats);
+    std::cout << "projected:  " << stats.projectedVertices << " vertices for " << stats.triangleCorners << " triangle corners ("
+              << std::fixed << std::setprecision(2) << (double)stats.triangleCorners / std::max<size_t>(1, stats.projectedVertices) << "x reuse)\n"
+              << "frustum:    " << stats.frustumCulledObjects << " of " << options.objects << " objects outside\n"
+              << "clipped:    " << stats.clippedTriangles << " triangles\n"
+              << "occluded:   " << stats.occludedObjects << " of " << options.objects << " objects\n"
+              << "culled:     " << stats.culledBackFacing << " back-facing, " << stats.culledSmall << " zero-area/sub-pixel of "
+              << stats.setupTriangles << " triangles (" << std::setprecision(1)
+              << 100.0 * (stats.culledBackFacing + stats.culledSmall) / std::max<size_t>(1, stats.setupTriangles) << "%)\n"
+              << "tiles:      " << options.tileSize << "x" << options.tileSize << ", " << stats.binnedEntries << " triangle-tile entries binned, "
+              << stats.fastClearedTiles << " still clear from the last frame\n"
+              << "dirty:      " << stats.dirtyTiles << " tiles in " << stats.dirtyRegions << " regions redrawn, "
+              << stats.unchangedObjects << " unchanged objects skipped\n";
+    if (options.fill == FillMode::Wireframe) {
+        std::cout << "edges:      " << stats.wireframeEdges << " lines drawn\n";
+    }
+    else if (options.samples > 1) {
+        std::cout << "msaa:       " << options.samples << "x, " << stats.expandedPixels << " pixels with per-sample storage ("
+                  << std::setprecision(1) << 100.0 * stats.expandedPixels / (double(options.width) * options.height) << "% of the screen)\n";
+    }
+    PrintPipeline(options.pipelineDepth, pipelineStats);
+    std::cout << std::setprecision(2)
+              << "total:      " << seconds * 1000.0 << " ms\n"
+              << "per frame:  " << seconds * 1000.0 / options.frames << " ms\n"
+              << "fps:        " << options.frames / seconds << std::endl;
+    WriteProfile(options);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,128 @@
+#pragma once
+#include "MathTypes.h"
+
+// Plane n . p + d = 0; points with a positive distance are on the side n faces.
+struct Plane {
+    vec3d normal;
+    float d = 0;
+
+    float distance(const vec3d& p) const { return normal.dot(p) + d; }
+};
+
+enum class FrustumTest {
+    Outside,
+    Intersecting,
+    Inside,
+};
+
+// Left, right, top, bottom and near planes, all facing inwards. There is no far
+// plane: depth is unbounded.
+struct Frustum {
+    static constexpr int PlaneCount = 5;
+    Plane planes[PlaneCount];
+
+    // Extracts the planes of a matrix that maps world space straight to
+    // homogeneous screen space: visible points have 0 <= X <= width * W,
+    // 0 <= Y <= height * W and W >= nearW.
+    static Frustum fromScreenProjection(const mat4& viewProjection, float width, float height, float nearW) {
+        const float* m = viewProjection.m;
+        vec4 rowX(m[0], m[1], m[2], m[3]);
+        vec4 rowY(m[4], m[5], m[6], m[7]);
+        vec4 rowW(m[12], m[13], m[14], m[15]);
+        vec4 rows[PlaneCount] = {
+            rowX,
+            vec4(width * rowW.x - rowX.x, width * rowW.y - rowX.y, width * rowW.z - rowX.z, width * rowW.w - rowX.w),
+            rowY,
+            vec4(height * rowW.x - rowY.x, height * rowW.y - rowY.y, height * rowW.z - rowY.z, height * rowW.w - rowY.w),
+            vec4(rowW.x, rowW.y, rowW.z, rowW.w - nearW),
+        };
+
+        Frustum frustum;
+        for (int i = 0; i < PlaneCount; ++i) {
+            float invLength = 1.0f / rows[i].xyz().length();
+            frustum.planes[i].normal = rows[i].xyz() * invLength;
+            frustum.planes[i].d = rows[i].w * invLength;
+        }
+        return frustum;
+    }
+
+    FrustumTest test(const BoundingSphere& sphere) const {
+        FrustumTest result = FrustumTest::Inside;
+        for (const Plane& plane : planes) {
+            float distance = plane.distance(sphere.center);
+            if (distance < -sphere.radius) return FrustumTest::Outside;
+            if (distance < sphere.radius) result = FrustumTest::Intersecting;
+        }
+        return result;
+    }
+};
+
+// Perspective camera looking down its local +z with y up, projecting straight
+// to pixels (y down). Lens shift moves the image on screen without moving the
+// eye, which is how the engine's orbit animation is expressed.
+//
+// Depth is z' = focalLength - focalLength^2 / viewZ, i.e. the old
+// z / (1 + z / focalLength) measured from the screen plane one focal length
+// in front of the eye.
+class Camera {
+public:
+    void setViewport(int width, int height) {
+        viewportWidth = width;
+        viewportHeight = height;
+    }
+
+    // aspectRatio scales both axes, like ProjectionParams::aspectRatio.
+    void setLens(float focal, float aspect) {
+        focalLength = focal;
+        aspectRatio = aspect;
+    }
+
+    void setShift(float x, float y) {
+        shiftX = x;
+        shiftY = y;
+    }
+
+    void setPosition(const vec3d& p) { position = p; }
+    void setOrientation(const quat& q) { orientation = q; }
+    // Nearest visible view-space depth.
+    void setNearDistance(float distance) { nearDistance = distance; }
+
+    const vec3d& getPosition() const { return position; }
+    const quat& getOrientation() const { return orientation; }
+    float getFocalLength() const { return focalLength; }
+    float getNearDistance() const { return nearDistance; }
+
+    mat4 getView() const {
+        return mat4::fromQuat(orientation.conjugate()) * mat4::translation(-position.x, -position.y, -position.z);
+    }
+
+    mat4 getProjection() const {
+        float scale = aspectRatio * focalLength;
+        float centerX = float(viewportWidth / 2) + shiftX;
+        float centerY = float(viewportHeight / 2) + shiftY;
+        return mat4{ {
+            scale, 0,      centerX,     0,
+            0,     -scale, centerY,     0,
+            0,     0,      focalLength, -focalLength * focalLength,
+            0,     0,      1,           0,
+        } };
+    }
+
+    mat4 getViewProjection() const {
+        return getProjection() * getView();
+    }
+
+    Frustum getFrustum() const {
+        return Frustum::fromScreenProjection(getViewProjection(), (float)viewportWidth, (float)viewportHeight, nearDistance);
+    }
+
+private:
+    int viewportWidth = 0;
+    int viewportHeight = 0;
+    float focalLength = 1;
+    float aspectRatio = 1;
+    float shiftX = 0, shiftY = 0;
+    float nearDistance = 1;
+    vec3d position;
+    quat orientation;
+};
@@ -0,0 +1,1628 @@
+// EngineTests.cpp : correctness checks for the headless rendering core, run by ctest.
+//
+// Usage: EngineTests
+//
+// Each test prints its name and result; the exit code is non-zero when any check fails.
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "AlignedBuffer.h"
+#include "Camera.h"
+#include "FrameLoop.h"
+#include "FramePipeline.h"
+#include "Framebuffer.h"
+#include "Geometry.h"
+#include "JobGraph.h"
+#include "MathTypes.h"
+#include "Profiler.h"
+#include "Rasterizer.h"
+#include "Renderer.h"
+#include "SampleBuffer.h"
+#include "ThreadPool.h"
+#include "VertexKernels.h"
+
+// Atomic, since checks may run on pool workers.
+static std::atomic<int> failedChecks{ 0 };
+
+#define CHECK(condition)                                                                   \
+    do {                                                                                   \
+        if (!(condition)) {                                                                \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed\n"; \
+            ++failedChecks;                                                                \
+        }                                                                                  \
+    } while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance)                                                              \
+    do {                                                                                                     \
+        float actualValue = (actual), expectedValue = (expected);                                            \
+        if (!(std::fabs(actualValue - expectedValue) <= (tolerance))) {                                      \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK_NEAR(" #actual ", " #expected ") failed: "  \
+                      << actualValue << " vs " << expectedValue << "\n";                                    \
+            ++failedChecks;                                                                                  \
+        }                                                                                                    \
+    } while (0)
+
+// Pixels that differ between two framebuffers of the same size.
+static int CountDifferences(const Framebuffer& a, const Framebuffer& b) {
+    int count = 0;
+    for (int y = 0; y < a.getHeight(); ++y) {
+        for (int x = 0; x < a.getWidth(); ++x) {
+            if (a.getPixel(x, y) != b.getPixel(x, y)) ++count;
+        }
+    }
+    return count;
+}
+
+// Pixels whose depth differs between two framebuffers of the same size.
+static int CountDepthDifferences(const Framebuffer& a, const Framebuffer& b) {
+    int count = 0;
+    for (int y = 0; y < a.getHeight(); ++y) {
+        for (int x = 0; x < a.getWidth(); ++x) {
+            if (a.getDepth(x, y) != b.getDepth(x, y)) ++count;
+        }
+    }
+    return count;
+}
+
+// Largest difference in any color channel between two pixels.
+static int ChannelDifference(uint32_t a, uint32_t b) {
+    int largest = 0;
+    for (int shift = 0; shift < 24; shift += 8) {
+        largest = std::max(largest, std::abs(int((a >> shift) & 0xFF) - int((b >> shift) & 0xFF)));
+    }
+    return largest;
+}
+
+// Pixels of framebuffer holding color.
+static int CountPixels(const Framebuffer& framebuffer, uint32_t color) {
+    int count = 0;
+    for (int y = 0; y < framebuffer.getHeight(); ++y) {
+        for (int x = 0; x < framebuffer.getWidth(); ++x) {
+            if (framebuffer.getPixel(x, y) == color) ++count;
+        }
+    }
+    return count;
+}
+
+static void CheckMatrixNear(const mat4& actual, const mat4& expected, float tolerance) {
+    for (int i = 0; i < 16; ++i) CHECK_NEAR(actual.m[i], expected.m[i], tolerance);
+}
+
+static void CheckVectorNear(const vec3d& actual, const vec3d& expected, float tolerance) {
+    CHECK_NEAR(actual.x, expected.x, tolerance);
+    CHECK_NEAR(actual.y, expected.y, tolerance);
+    CHECK_NEAR(actual.z, expected.z, tolerance);
+}
+
+static void TestFramebufferRows() {
+    for (int width : { 1, 7, 8, 9, 33, 100 }) {
+        Framebuffer framebuffer(width, 5);
+        int pitch = framebuffer.getPitch();
+        CHECK(pitch % Framebuffer::PixelsPerAlignment == 0);
+        CHECK(pitch >= width && pitch < width + Framebuffer::PixelsPerAlignment);
+        for (int y = 0; y < framebuffer.getHeight(); ++y) {
+            CHECK(framebuffer.getRow(y) == framebuffer.getPixels() + size_t(y) * pitch);
+            CHECK(reinterpret_cast<uintptr_t>(framebuffer.getRow(y)) % Framebuffer::Alignment == 0);
+            CHECK(reinterpret_cast<uintptr_t>(framebuffer.getDepthRow(y)) % Framebuffer::Alignment == 0);
+            CHECK(framebuffer.getDepthRow(y)[width - 1] == Framebuffer::FarDepth);
+        }
+
+        framebuffer.clear(MakeColor(1, 2, 3));
+        framebuffer.setPixel(width - 1, 4, MakeColor(4, 5, 6));
+        framebuffer.setPixel(width, 4, MakeColor(7, 8, 9));
+        framebuffer.setPixel(-1, 0, MakeColor(7, 8, 9));
+        CHECK(framebuffer.getRow(4)[width - 1] == MakeColor(4, 5, 6));
+        CHECK(CountPixels(framebuffer, MakeColor(1, 2, 3)) == width * 5 - 1);
+    }
+}
+
+// Lines include both endpoints, take one pixel per step along the major axis
+// and drop whatever falls outside the framebuffer.
+static void TestLineEndpoints() {
+    const uint32_t ink = MakeColor(0, 0, 255);
+    const int lines[][4] = { { 2, 3, 20, 3 }, { 5, 1, 5, 14 }, { 1, 1, 14, 14 }, { 18, 2, 3, 9 }, { 7, 7, 7, 7 } };
+    Framebuffer framebuffer(24, 16);
+    for (const int* line : lines) {
+        framebuffer.clear(0);
+        DrawLine(framebuffer, line[0], line[1], line[2], line[3], ink);
+        CHECK(framebuffer.getPixel(line[0], line[1]) == ink);
+        CHECK(framebuffer.getPixel(line[2], line[3]) == ink);
+        CHECK(CountPixels(framebuffer, ink) == std::max(std::abs(line[2] - line[0]), std::abs(line[3] - line[1])) + 1);
+    }
+
+    framebuffer.clear(0);
+    DrawLine(framebuffer, -10, 8, 40, 8, ink);
+    CHECK(CountPixels(framebuffer, ink) == 24);
+}
+
+// Submitted tasks have all run by the time wait() returns.
+static void TestThreadPool() {
+    for (unsigned workers : { 0u, 1u, 3u }) {
+        ThreadPool pool(workers);
+        CHECK(pool.getWorkerCount() == workers);
+
+        std::atomic<int> ran{ 0 };
+        for (int i = 0; i < 100; ++i) {
+            pool.submit([&ran]() { ran.fetch_add(1); });
+        }
+        pool.wait();
+        CHECK(ran.load() == 100);
+    }
+}
+
+// A job starts only after all of its prerequisites have finished. The graph
+// holds a chain, a diamond and a wide fan-in, and is rebuilt in place every
+// round, on pools from caller-only up to several workers.
+static void TestJobGraphOrdering() {
+    for (unsigned workers : { 0u, 1u, 2u, 4u }) {
+        ThreadPool pool(workers);
+        JobGraph graph;
+        for (int round = 0; round < 20; ++round) {
+            graph.clear();
+            std::atomic<int> clock{ 0 };
+            std::unique_ptr<std::atomic<int>[]> started(new std::atomic<int>[64]()), finished(new std::atomic<int>[64]());
+            std::vector<std::pair<JobGraph::JobId, JobGraph::JobId>> edges;
+            auto add = [&]() {
+                JobGraph::JobId id = graph.size();
+                CHECK(graph.add([&, id]() {
+                    started[id] = ++clock;
+                    std::this_thread::yield();
+                    finished[id] = ++clock;
+                }) == id);
+                return id;
+            };
+            auto depend = [&](JobGraph::JobId prerequisite, JobGraph::JobId job) {
+                graph.addDependency(prerequisite, job);
+                edges.emplace_back(prerequisite, job);
+            };
+
+            JobGraph::JobId previous = add();
+            for (int i = 0; i < 8; ++i) {
+                JobGraph::JobId next = add();
+                depend(previous, next);
+                previous = next;
+            }
+            JobGraph::JobId top = add(), left = add(), right = add(), bottom = add();
+            depend(top, left);
+            depend(top, right);
+            depend(left, bottom);
+            depend(right, bottom);
+            JobGraph::JobId sink = add();
+            depend(bottom, sink);
+            for (int i = 0; i < 16; ++i) depend(add(), sink);
+
+            graph.run(pool);
+            CHECK(clock.load() == int(graph.size()) * 2);
+            for (size_t i = 0; i < graph.size(); ++i) CHECK(started[i] > 0 && finished[i] > started[i]);
+            for (const auto& edge : edges) CHECK(finished[edge.first] < started[edge.second]);
+        }
+    }
+}
+
+// Index width follows the vertex count, and triangles read back the indices
+// they were given on either side of the 16-bit limit.
+static void TestMeshIndices() {
+    Sphere sphere(1.0f, 8, 12);
+    const Mesh& sphereMesh = sphere.getMesh();
+    CHECK(sphereMesh.vertices.size() == 9 * 13);
+    CHECK(sphereMesh.getTriangleCount() == 8 * 12 * 2);
+    CHECK(sphereMesh.hasShortIndices());
+    for (size_t t = 0; t < sphereMesh.getTriangleCount(); ++t) {
+        uint32_t a, b, c;
+        sphereMesh.getTriangle(t, a, b, c);
+        CHECK(a < sphereMesh.vertices.size() && b < sphereMesh.vertices.size() && c < sphereMesh.vertices.size());
+        CHECK(a != b && b != c && a != c);
+    }
+
+    for (size_t vertexCount : { size_t(0x10000), size_t(0x10001) }) {
+        Mesh mesh;
+        mesh.vertices.resize(vertexCount);
+        const std::vector<uint32_t> indices = { 0, 1, uint32_t(vertexCount - 1), 2, uint32_t(vertexCount - 2), 3 };
+        mesh.setIndices(indices);
+        CHECK(mesh.hasShortIndices() == (vertexCount <= 0x10000));
+        CHECK(mesh.getTriangleCount() == 2);
+        for (size_t t = 0; t < 2; ++t) {
+            uint32_t a, b, c;
+            mesh.getTriangle(t, a, b, c);
+            CHECK(a == indices[t * 3] && b == indices[t * 3 + 1] && c == indices[t * 3 + 2]);
+        }
+    }
+}
+
+// A stream of count values followed by guard slots that kernels must leave alone.
+struct GuardedStream {
+    static constexpr size_t GuardCount = 16;
+    static constexpr float Guard = -12345.0f;
+    std::vector<float> values;
+
+    explicit GuardedStream(size_t count) : values(count + GuardCount, Guard) {}
+    float* get() { return values.data(); }
+    bool guardIntact(size_t count) const {
+        return std::all_of(values.begin() + count, values.end(), [](float v) { return v == Guard; });
+    }
+};
+
+// Every vector kernel the host can run matches the scalar reference, including
+// the scalar tails, and writes nothing past count. Counts avoid multiples of
+// the register widths so every level runs its tail loop.
+static void TestVertexKernels() {
+    const float rotation[9] = { 0.36f, 0.48f, -0.8f, -0.8f, 0.6f, 0.0f, 0.48f, 0.64f, 0.6f };
+    const float matrix[16] = { 1.2f, 0.1f, -0.3f, 4.0f, 0.2f, 0.9f, 0.4f, -2.0f, -0.1f, 0.3f, 1.1f, 250.0f, 0.0f, 0.0f, 0.01f, 1.0f };
+    const ProjectionParams params = { 400.0f, 300.0f, 70.0f, 16.0f / 9.0f, 3.0f, -5.0f };
+    const VertexKernels& scalar = GetVertexKernels(SimdLevel::Scalar);
+
+    for (SimdLevel level : { SimdLevel::SSE, SimdLevel::AVX2, SimdLevel::AVX512, SimdLevel::NEON }) {
+        if (!IsSimdLevelSupported(level)) continue;
+        const VertexKernels& kernels = GetVertexKernels(level);
+        CHECK(kernels.level == level);
+        for (size_t count : { 1, 3, 5, 7, 13, 17, 31, 33, 47, 63, 65, 100 }) {
+            GuardedStream x(count), y(count), z(count);
+            uint32_t seed = uint32_t(count) * 2654435761u;
+            auto next = [&seed]() {
+                seed = seed * 1664525u + 1013904223u;
+                return float(seed >> 8) / float(1 << 24);
+            };
+            for (size_t i = 0; i < count; ++i) {
+                x.values[i] = next() * 200.0f - 100.0f;
+                y.values[i] = next() * 200.0f - 100.0f;
+                z.values[i] = next() * 500.0f;
+            }
+            const std::vector<float> inX(x.values), inY(y.values), inZ(z.values);
+
+            GuardedStream tx(count), ty(count), tz(count), tw(count);
+            GuardedStream rx(count), ry(count), rz(count), rw(count);
+            kernels.transform(matrix, x.get(), y.get(), z.get(), tx.get(), ty.get(), tz.get(), tw.get(), count);
+            scalar.transform(matrix, x.get(), y.get(), z.get(), rx.get(), ry.get(), rz.get(), rw.get(), count);
+            for (size_t i = 0; i < count; ++i) {
+                CHECK_NEAR(tx.values[i], rx.values[i], 1e-3f);
+                CHECK_NEAR(ty.values[i], ry.values[i], 1e-3f);
+                CHECK_NEAR(tz.values[i], rz.values[i], 1e-3f);
+                CHECK_NEAR(tw.values[i], rw.values[i], 1e-5f);
+            }
+            CHECK(tx.guardIntact(count) && ty.guardIntact(count) && tz.guardIntact(count) && tw.guardIntact(count));
+
+            GuardedStream px(count), py(count), qx(count), qy(count);
+            kernels.project(params, x.get(), y.get(), z.get(), px.get(), py.get(), count);
+            scalar.project(params, x.get(), y.get(), z.get(), qx.get(), qy.get(), count);
+            for (size_t i = 0; i < count; ++i) {
+                CHECK_NEAR(px.values[i], qx.values[i], 1e-3f);
+                CHECK_NEAR(py.values[i], qy.values[i], 1e-3f);
+            }
+            CHECK(px.guardIntact(count) && py.guardIntact(count));
+
+            GuardedStream fx(count), fy(count), fz(count), fw(count), gx(count), gy(count), gz(count), gw(count);
+            kernels.transformProject(matrix, x.get(), y.get(), z.get(), fx.get(), fy.get(), fz.get(), fw.get(), count);
+            scalar.transformProject(matrix, x.get(), y.get(), z.get(), gx.get(), gy.get(), gz.get(), gw.get(), count);
+            for (size_t i = 0; i < count; ++i) {
+                CHECK_NEAR(fx.values[i], gx.values[i], 1e-3f);
+                CHECK_NEAR(fy.values[i], gy.values[i], 1e-3f);
+                CHECK_NEAR(fz.values[i], gz.values[i], 1e-3f);
+                CHECK_NEAR(fw.values[i], gw.values[i], 1e-5f);
+            }
+            CHECK(fx.guardIntact(count) && fy.guardIntact(count) && fz.guardIntact(count) && fw.guardIntact(count));
+            GuardedStream hx(count), hy(count), hz(count);
+            kernels.transformProject(matrix, x.get(), y.get(), z.get(), hx.get(), hy.get(), hz.get(), nullptr, count);
+            CHECK(hx.values == fx.values && hy.values == fy.values && hz.values == fz.values);
+
+            // In place, then against the scalar result on a copy of the input.
+            GuardedStream sx(count), sy(count), sz(count);
+            std::copy(inX.begin(), inX.end(), sx.values.begin());
+            std::copy(inY.begin(), inY.end(), sy.values.begin());
+            std::copy(inZ.begin(), inZ.end(), sz.values.begin());
+            kernels.rotate(rotation, x.get(), y.get(), z.get(), count);
+            scalar.rotate(rotation, sx.get(), sy.get(), sz.get(), count);
+            for (size_t i = 0; i < count; ++i) {
+                CHECK_NEAR(x.values[i], sx.values[i], 1e-3f);
+                CHECK_NEAR(y.values[i], sy.values[i], 1e-3f);
+                CHECK_NEAR(z.values[i], sz.values[i], 1e-3f);
+            }
+            CHECK(x.guardIntact(count) && y.guardIntact(count) && z.guardIntact(count));
+
+            // Transform may write over its input.
+            kernels.transform(matrix, sx.get(), sy.get(), sz.get(), sx.get(), sy.get(), sz.get(), nullptr, count);
+            scalar.transform(matrix, x.get(), y.get(), z.get(), rx.get(), ry.get(), rz.get(), nullptr, count);
+            for (size_t i = 0; i < count; ++i) {
+                CHECK_NEAR(sx.values[i], rx.values[i], 1e-2f);
+                CHECK_NEAR(sy.values[i], ry.values[i], 1e-2f);
+                CHECK_NEAR(sz.values[i], rz.values[i], 1e-2f);
+            }
+            CHECK(sx.guardIntact(count) && sy.guardIntact(count) && sz.guardIntact(count));
+        }
+    }
+}
+
+// An object's transform is rebuilt from its orientation every time: applied to
+// the rest pose it matches rotating about X, then Y, then Z, and returning to an
+// earlier orientation after many rotations reproduces it exactly.
+static void TestRestPoseTransform() {
+    Sphere sphere(50.0f, 6, 9);
+    const VertexStreams& rest = sphere.getMesh().vertices;
+    const std::vector<float> restX(rest.x.get(), rest.x.get() + rest.size());
+
+    const float angleX = 0.7f, angleY = -1.3f, angleZ = 2.1f;
+    sphere.rotate(angleX, angleY, angleZ);
+    const mat4 first = sphere.getTransform();
+    for (size_t i = 0; i < rest.size(); ++i) {
+        float x = rest.x[i], y = rest.y[i], z = rest.z[i];
+        float ry = y * std::cos(angleX) - z * std::sin(angleX);
+        float rz = y * std::sin(angleX) + z * std::cos(angleX);
+        float rx = x * std::cos(angleY) + rz * std::sin(angleY);
+        rz = -x * std::sin(angleY) + rz * std::cos(angleY);
+        float fx = rx * std::cos(angleZ) - ry * std::sin(angleZ);
+        float fy = rx * std::sin(angleZ) + ry * std::cos(angleZ);
+        CheckVectorNear(first.transformPoint(vec3d(x, y, z)).xyz(), vec3d(fx, fy, rz), 1e-3f);
+    }
+
+    for (int step = 1; step <= 500; ++step) {
+        sphere.rotate(angleX + step * 0.01f, angleY - step * 0.02f, angleZ + step * 0.03f);
+    }
+    sphere.rotate(angleX, angleY, angleZ);
+    CHECK(sphere.getTransform() == first);
+    CHECK(std::equal(restX.begin(), restX.end(), rest.x.get()));
+
+    sphere.rotate(0, 0, 0);
+    CHECK(sphere.getTransform() == mat4::identity());
+}
+
+// The per-vertex path objects took before the MVP matrix: rotate about X, Y and Z
+// with precomputed sines and cosines, then divide by 1 + z / (fov * scale).
+static vec3d LegacyRotateAndProject(vec3d v, const float* sinCos, float centerX, float centerY, float scale, float moveX, float moveY) {
+    float y = v.y * sinCos[1] - v.z * sinCos[0];
+    float z = v.y * sinCos[0] + v.z * sinCos[1];
+    v.y = y; v.z = z;
+    float x = v.x * sinCos[3] + v.z * sinCos[2];
+    z = -v.x * sinCos[2] + v.z * sinCos[3];
+    v.x = x; v.z = z;
+    x = v.x * sinCos[5] - v.y * sinCos[4];
+    y = v.x * sinCos[4] + v.y * sinCos[5];
+    v.x = x; v.y = y;
+
+    const float fov = 70.0f;
+    const float aspectRatio = 16.0f / 9.0f;
+    float projectedX = v.x / (1 + v.z / (fov * scale)) * aspectRatio;
+    float projectedY = v.y / (1 + v.z / (fov * scale)) * aspectRatio;
+    return vec3d(centerX + projectedX + moveX, centerY - projectedY + moveY, v.z);
+}
+
+static const float EulerAngles[][3] = {
+    { 0, 0, 0 }, { 0.3f, 0.2f, 0.1f }, { -1.2f, 0.7f, 2.9f }, { 3.0f, -1.5f, -0.4f }, { 0.001f, 0.002f, 0.003f },
+};
+
+// quat::fromEuler, its matrix and rotating by the quaternion directly must all
+// agree with rotating about X, then Y, then Z.
+static void TestQuatMatchesEuler() {
+    const vec3d points[] = { vec3d(1, 0, 0), vec3d(0, 1, 0), vec3d(0, 0, 1), vec3d(3, -4, 12) };
+    for (const float* angles : EulerAngles) {
+        quat q = quat::fromEuler(angles[0], angles[1], angles[2]);
+        mat4 euler = mat4::rotationZ(angles[2]) * mat4::rotationY(angles[1]) * mat4::rotationX(angles[0]);
+        CheckMatrixNear(mat4::fromQuat(q), euler, 1e-5f);
+        CHECK_NEAR(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w, 1.0f, 1e-5f);
+        for (const vec3d& p : points) {
+            CheckVectorNear(q.rotate(p), euler.transformPoint(p).xyz(), 1e-4f);
+            CheckVectorNear(q.conjugate().rotate(q.rotate(p)), p, 1e-4f);
+        }
+    }
+}
+
+static void TestMat4MultiplyInverse() {
+    const mat4 a = mat4::fromQuat(quat::fromEuler(0.3f, 0.2f, 0.1f));
+    const mat4 b = mat4::translation(5, -7, 11) * mat4::scale(2, 3, 0.5f);
+    const mat4 c = mat4::screenProjection({ 960.0f, 540.0f, 560.0f, 16.0f / 9.0f, 40.0f, -25.0f });
+    CHECK(mat4::identity() * a == a);
+    CHECK(a * mat4::identity() == a);
+    CheckMatrixNear((a * b) * c, a * (b * c), 1e-2f);
+    CheckMatrixNear(mat4::translation(1, 2, 3) * mat4::translation(4, 5, 6), mat4::translation(5, 7, 9), 0);
+    CheckVectorNear((a * b).transformPoint(vec3d(1, 2, 3)).xyz(), a.transformPoint(b.transformPoint(vec3d(1, 2, 3)).xyz()).xyz(), 1e-4f);
+
+    // mat4 has no general inverse; check the ones the engine relies on: a
+    // rotation's transpose and conjugate, a negated translation and the
+    // camera's view as the inverse of its placement.
+    for (const float* angles : EulerAngles) {
+        mat4 rotation = mat4::fromQuat(quat::fromEuler(angles[0], angles[1], angles[2]));
+        mat4 transpose;
+        for (int i = 0; i < 16; ++i) transpose.m[i] = rotation.m[(i % 4) * 4 + i / 4];
+        CheckMatrixNear(rotation * transpose, mat4::identity(), 1e-5f);
+        CheckMatrixNear(transpose * rotation, mat4::identity(), 1e-5f);
+        CheckMatrixNear(rotation * mat4::fromQuat(quat::fromEuler(angles[0], angles[1], angles[2]).conjugate()), mat4::identity(), 1e-5f);
+
+        Camera camera;
+        camera.setPosition(vec3d(angles[0] * 100, angles[1] * 100, angles[2] * -100));
+        camera.setOrientation(quat::fromEuler(angles[0], angles[1], angles[2]));
+        mat4 placement = mat4::translation(angles[0] * 100, angles[1] * 100, angles[2] * -100) * rotation;
+        CheckMatrixNear(camera.getView() * placement, mat4::identity(), 1e-4f);
+        CheckMatrixNear(placement * camera.getView(), mat4::identity(), 1e-4f);
+    }
+    CheckMatrixNear(mat4::translation(5, -7, 11) * mat4::translation(-5, 7, -11), mat4::identity(), 0);
+}
+
+// One MVP matrix per object must put every vertex on the same pixel as the old
+// rotate-three-times-then-project path.
+static void TestMvpMatchesLegacyProjection() {
+    Sphere sphere(100.0f, 40, 40);
+    const VertexStreams& rest = sphere.getMesh().vertices;
+    for (const float* angles : EulerAngles) {
+        const float sinCos[6] = { std::sin(angles[0]), std::cos(angles[0]), std::sin(angles[1]), std::cos(angles[1]), std::sin(angles[2]), std::cos(angles[2]) };
+        ProjectionParams params = { 960.0f, 540.0f, 560.0f, 16.0f / 9.0f, 40.0f, -25.0f };
+        mat4 mvp = mat4::screenProjection(params) * mat4::fromQuat(quat::fromEuler(angles[0], angles[1], angles[2]));
+        for (size_t i = 0; i < rest.size(); ++i) {
+            vec3d p(rest.x[i], rest.y[i], rest.z[i]);
+            vec3d legacy = LegacyRotateAndProject(p, sinCos, 960.0f, 540.0f, 8.0f, 40.0f, -25.0f);
+            vec3d projected = mvp.transformPoint(p).project();
+            CHECK_NEAR(projected.x, legacy.x, 0.01f);
+            CHECK_NEAR(projected.y, legacy.y, 0.01f);
+        }
+    }
+}
+
+// Each shared vertex is projected once per frame, and the frame does not
+// depend on how many workers rendered it.
+static void TestProjectionCache() {
+    // Equal radii, so neither sphere hides the other from the occlusion pass.
+    Sphere coarse(150.0f, 8, 12), fine(150.0f, 30, 40);
+    // Large enough to keep the orbiting scene on screen.
+    Renderer serial(1280, 960, 0), parallel(1280, 960, 3);
+    for (Renderer* renderer : { &serial, &parallel }) {
+        renderer->addObject(&coarse);
+        renderer->addObject(&fine);
+    }
+    for (int frame = 0; frame < 5; ++frame) {
+        serial.update();
+        serial.render();
+        parallel.update();
+        parallel.render();
+        CHECK(CountDifferences(serial.getFramebuffer(), parallel.getFramebuffer()) == 0);
+    }
+    CHECK(CountPixels(serial.getFramebuffer(), MakeColor(0, 0, 255)) > 1000);
+
+    const RenderStats& stats = serial.getStats();
+    CHECK(stats.projectedVertices == 9 * 13 + 31 * 41);
+    CHECK(stats.triangleCorners == 3 * (8 * 12 * 2 + 30 * 40 * 2));
+    CHECK(parallel.getStats().projectedVertices == stats.projectedVertices);
+}
+
+// A fan around the centre of a square whose corners sit on pixel centres, so
+// every edge passes exactly through pixel centres. The top-left rule must hand
+// each of those pixels to exactly one triangle, include the square's top and
+// left edges and leave out its right and bottom edges.
+static void TestFillRule() {
+    const vec3d corners[4] = { vec3d(2.5f, 2.5f, 0), vec3d(12.5f, 2.5f, 0), vec3d(12.5f, 12.5f, 0), vec3d(2.5f, 12.5f, 0) };
+    const vec3d centre(7.5f, 7.5f, 0);
+    const uint32_t covered = MakeColor(255, 255, 255);
+    Framebuffer framebuffer(16, 16);
+    std::vector<int> hits(16 * 16, 0);
+    for (int i = 0; i < 4; ++i) {
+        framebuffer.clear(0);
+        framebuffer.clearDepth();
+        // Alternate windings; both are accepted.
+        if (i % 2) {
+            FillTriangle(framebuffer, centre, corners[i], corners[(i + 1) % 4], covered);
+        } else {
+            FillTriangle(framebuffer, corners[(i + 1) % 4], corners[i], centre, covered);
+        }
+        for (int y = 0; y < 16; ++y) {
+            for (int x = 0; x < 16; ++x) {
+                if (framebuffer.getPixel(x, y) == covered) ++hits[y * 16 + x];
+            }
+        }
+    }
+
+    for (int y = 0; y < 16; ++y) {
+        for (int x = 0; x < 16; ++x) {
+            bool inside = x >= 2 && x < 12 && y >= 2 && y < 12;
+            CHECK(hits[y * 16 + x] == (inside ? 1 : 0));
+        }
+    }
+
+    // The clip variant writes only inside its rectangle.
+    framebuffer.clear(0);
+    framebuffer.clearDepth();
+    FillTriangle(framebuffer, corners[0], corners[1], corners[2], covered, ScreenRect{ 0, 0, 8, 16 });
+    FillTriangle(framebuffer, corners[0], corners[2], corners[3], covered, ScreenRect{ 0, 0, 8, 16 });
+    CHECK(CountPixels(framebuffer, covered) == 6 * 10);
+}
+
+// A grid of triangles with jittered, off-centre inner vertices and a straight
+// outer border covers every pixel of the framebuffer exactly once, through
+// whole, partial and skipped 8x8 blocks alike.
+static void TestFillSharedEdges() {
+    const int size = 64, cells = 8, cellSize = size / cells;
+    std::vector<vec3d> grid;
+    uint32_t seed = 12345;
+    for (int gy = 0; gy <= cells; ++gy) {
+        for (int gx = 0; gx <= cells; ++gx) {
+            float jitterX = 0, jitterY = 0;
+            if (gx > 0 && gx < cells && gy > 0 && gy < cells) {
+                seed = seed * 1664525u + 1013904223u;
+                jitterX = float(int(seed >> 16) % 61 - 30) / 10.0f;
+                seed = seed * 1664525u + 1013904223u;
+                jitterY = float(int(seed >> 16) % 61 - 30) / 10.0f;
+            }
+            grid.push_back(vec3d(gx * cellSize + jitterX, gy * cellSize + jitterY, 0));
+        }
+    }
+
+    const uint32_t covered = MakeColor(255, 255, 255);
+    Framebuffer framebuffer(size, size);
+    std::vector<int> hits(size * size, 0);
+    auto draw = [&](const vec3d& a, const vec3d& b, const vec3d& c) {
+        framebuffer.clear(0);
+        framebuffer.clearDepth();
+        FillTriangle(framebuffer, a, b, c, covered);
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+                if (framebuffer.getPixel(x, y) == covered) ++hits[y * size + x];
+            }
+        }
+    };
+    for (int gy = 0; gy < cells; ++gy) {
+        for (int gx = 0; gx < cells; ++gx) {
+            const vec3d& topLeft = grid[gy * (cells + 1) + gx];
+            const vec3d& topRight = grid[gy * (cells + 1) + gx + 1];
+            const vec3d& bottomLeft = grid[(gy + 1) * (cells + 1) + gx];
+            const vec3d& bottomRight = grid[(gy + 1) * (cells + 1) + gx + 1];
+            draw(topLeft, topRight, bottomRight);
+            draw(topLeft, bottomLeft, bottomRight);
+        }
+    }
+    CHECK(std::all_of(hits.begin(), hits.end(), [](int h) { return h == 1; }));
+}
+
+// The nearer surface wins whichever order the triangles arrive in.
+static void TestDepthOrdering() {
+    const uint32_t nearColor = MakeColor(0, 255, 0), farColor = MakeColor(255, 0, 0);
+    Framebuffer framebuffer(8, 8);
+    for (bool nearFirst : { false, true }) {
+        framebuffer.clear(0);
+        framebuffer.clearDepth();
+        for (int pass = 0; pass < 2; ++pass) {
+            bool drawNear = (pass == 0) == nearFirst;
+            float z = drawNear ? 0.25f : 0.75f;
+            uint32_t color = drawNear ? nearColor : farColor;
+            FillTriangle(framebuffer, vec3d(0, 0, z), vec3d(8, 0, z), vec3d(0, 8, z), color);
+            FillTriangle(framebuffer, vec3d(8, 0, z), vec3d(8, 8, z), vec3d(0, 8, z), color);
+        }
+        CHECK(CountPixels(framebuffer, nearColor) == 64);
+        for (int y = 0; y < 8; ++y) {
+            for (int x = 0; x < 8; ++x) CHECK(framebuffer.getDepth(x, y) == 0.25f);
+        }
+    }
+
+    // Interpolated depth: a sloped triangle passes through a flat one along
+    // x = 4, the flat one hiding the half where the slope lies behind it.
+    framebuffer.clear(0);
+    framebuffer.clearDepth();
+    FillTriangle(framebuffer, vec3d(0, 0, 0.5f), vec3d(8, 0, 0.5f), vec3d(0, 8, 0.5f), farColor);
+    FillTriangle(framebuffer, vec3d(8, 0, 0.5f), vec3d(8, 8, 0.5f), vec3d(0, 8, 0.5f), farColor);
+    FillTriangle(framebuffer, vec3d(0, 0, 0), vec3d(8, 0, 1), vec3d(0, 8, 0), nearColor);
+    FillTriangle(framebuffer, vec3d(8, 0, 1), vec3d(8, 8, 1), vec3d(0, 8, 0), nearColor);
+    for (int y = 0; y < 8; ++y) {
+        for (int x = 0; x < 8; ++x) CHECK(framebuffer.getPixel(x, y) == (x < 4 ? nearColor : farColor));
+    }
+}
+
+// The coarse plane bounds the depths below it: a rectangle is occluded only
+// where every block already holds something nearer.
+static void TestCoarseDepth() {
+    const int block = Framebuffer::CoarseBlockSize;
+    Framebuffer framebuffer(64, 48);
+    const ScreenRect all = { 0, 0, 64, 48 };
+    CHECK(!framebuffer.isOccluded(all, 1000.0f));
+    CHECK(framebuffer.isOccluded(ScreenRect{ 64, 0, 80, 48 }, 0.0f));
+
+    // Covers blocks 0..3 horizontally (x < 32) in every row.
+    FillTriangle(framebuffer, vec3d(0, 0, 0.25f), vec3d(32, 0, 0.25f), vec3d(0, 48, 0.25f), MakeColor(255, 0, 0));
+    FillTriangle(framebuffer, vec3d(32, 0, 0.25f), vec3d(32, 48, 0.25f), vec3d(0, 48, 0.25f), MakeColor(255, 0, 0));
+    for (int by = 0; by < 48 / block; ++by) {
+        for (int bx = 0; bx < 32 / block; ++bx) CHECK(framebuffer.getCoarseDepth(bx, by) == 0.25f);
+        CHECK(framebuffer.getCoarseDepth(32 / block, by) == Framebuffer::FarDepth);
+    }
+    const ScreenRect covered = { 3, 5, 30, 40 };
+    CHECK(framebuffer.isOccluded(covered, 0.5f));
+    CHECK(framebuffer.isOccluded(covered, 0.25f));
+    CHECK(!framebuffer.isOccluded(covered, 0.1f));
+    CHECK(!framebuffer.isOccluded(ScreenRect{ 3, 5, 33, 40 }, 0.5f));
+
+    // A nearer surface behind the bound changes nothing; the block is hidden.
+    FillTriangle(framebuffer, vec3d(0, 0, 0.5f), vec3d(16, 0, 0.5f), vec3d(0, 16, 0.5f), MakeColor(0, 255, 0));
+    CHECK(CountPixels(framebuffer, MakeColor(0, 255, 0)) == 0);
+
+    framebuffer.clearDepth();
+    CHECK(!framebuffer.isOccluded(covered, 0.5f));
+}
+
+// An object inside a nearer one is skipped without changing the frame.
+static void TestOcclusionCulling() {
+    Sphere outer(300.0f, 40, 40), inner(100.0f, 20, 20);
+    Renderer both(1280, 960, 2), outerOnly(1280, 960, 2);
+    both.addObject(&outer);
+    both.addObject(&inner);
+    outerOnly.addObject(&outer);
+    for (int frame = 0; frame < 3; ++frame) {
+        both.update();
+        both.render();
+        outerOnly.update();
+        outerOnly.render();
+        CHECK(both.getStats().occludedObjects == 1);
+        CHECK(outerOnly.getStats().occludedObjects == 0);
+        CHECK(CountDifferences(both.getFramebuffer(), outerOnly.getFramebuffer()) == 0);
+    }
+}
+
+// On a closed mesh, culling back faces leaves the same color and depth as
+// drawing everything; culling front faces leaves the far side.
+static void TestBackFaceCulling() {
+    Sphere sphere(100.0f, 24, 32);
+    Renderer none(1280, 960, 2), back(1280, 960, 2), front(1280, 960, 2);
+    for (Renderer* renderer : { &none, &back, &front }) {
+        renderer->addObject(&sphere);
+    }
+    const CullMode modes[] = { CullMode::None, CullMode::Back, CullMode::Front };
+    Renderer* renderers[] = { &none, &back, &front };
+    for (int i = 0; i < 3; ++i) {
+        sphere.setCullMode(modes[i]);
+        renderers[i]->update();
+        renderers[i]->render();
+    }
+    CHECK(CountDifferences(none.getFramebuffer(), back.getFramebuffer()) == 0);
+    CHECK(CountDepthDifferences(none.getFramebuffer(), back.getFramebuffer()) == 0);
+
+    const size_t triangles = sphere.getMesh().getTriangleCount();
+    CHECK(none.getStats().setupTriangles == triangles);
+    CHECK(none.getStats().culledBackFacing == 0);
+    // The sphere is fully on screen, so every triangle that is not too small
+    // to fill faces one way or the other.
+    const RenderStats& backStats = back.getStats();
+    const RenderStats& frontStats = front.getStats();
+    CHECK(backStats.culledBackFacing > 0 && frontStats.culledBackFacing > 0);
+    CHECK(frontStats.culledSmall == backStats.culledSmall);
+    CHECK(backStats.culledBackFacing + frontStats.culledBackFacing + backStats.culledSmall == triangles);
+
+    // Wherever the sphere is drawn, its far side lies behind its near side.
+    int drawn = 0;
+    const Framebuffer& nearSide = none.getFramebuffer();
+    const Framebuffer& farSide = front.getFramebuffer();
+    for (int y = 0; y < nearSide.getHeight(); ++y) {
+        for (int x = 0; x < nearSide.getWidth(); ++x) {
+            if (nearSide.getDepth(x, y) == Framebuffer::FarDepth) continue;
+            ++drawn;
+            CHECK(farSide.getDepth(x, y) >= nearSide.getDepth(x, y));
+        }
+    }
+    CHECK(drawn > 1000);
+    sphere.setCullMode(CullMode::Back);
+}
+
+// Bounding spheres are classified against the camera's side and near planes.
+// The camera sits one focal length in front of the origin, so at z = 0 the
+// left edge of a 640x480 view is x = -320 and the top edge y = 240.
+static void TestFrustum() {
+    Camera camera;
+    camera.setViewport(640, 480);
+    camera.setLens(560.0f, 1.0f);
+    camera.setPosition(vec3d(0, 0, -560.0f));
+    camera.setNearDistance(10.0f);
+    const Frustum frustum = camera.getFrustum();
+    for (const Plane& plane : frustum.planes) CHECK_NEAR(plane.normal.length(), 1.0f, 1e-5f);
+
+    auto test = [&](float x, float y, float z, float radius) { return frustum.test(BoundingSphere{ vec3d(x, y, z), radius }); };
+    CHECK(test(0, 0, 0, 10) == FrustumTest::Inside);
+    CHECK(test(0, 0, 5000, 10) == FrustumTest::Inside);
+    CHECK(test(-320, 0, 0, 10) == FrustumTest::Intersecting);
+    CHECK(test(320, 0, 0, 10) == FrustumTest::Intersecting);
+    CHECK(test(0, 240, 0, 10) == FrustumTest::Intersecting);
+    CHECK(test(0, -240, 0, 10) == FrustumTest::Intersecting);
+    CHECK(test(-340, 0, 0, 10) == FrustumTest::Outside);
+    CHECK(test(0, -260, 0, 10) == FrustumTest::Outside);
+    CHECK(test(-300, 0, 0, 10) == FrustumTest::Inside);
+    // Near plane at view depth 10, i.e. z = -550; behind the eye is outside.
+    CHECK(test(0, 0, -550, 5) == FrustumTest::Intersecting);
+    CHECK(test(0, 0, -556, 5) == FrustumTest::Outside);
+    CHECK(test(0, 0, -2000, 100) == FrustumTest::Outside);
+
+    // Lens shift moves the frustum with the image.
+    camera.setShift(320.0f, 0);
+    const Frustum shifted = camera.getFrustum();
+    CHECK(shifted.test(BoundingSphere{ vec3d(-340, 0, 0), 10 }) == FrustumTest::Inside);
+    CHECK(shifted.test(BoundingSphere{ vec3d(20, 0, 0), 10 }) == FrustumTest::Outside);
+}
+
+// At 320x240 the orbit shift carries the scene out of view: the sphere is
+// dropped before any vertex work and the frame stays clear.
+static void TestFrustumCulling() {
+    Sphere sphere(100.0f, 16, 16);
+    Renderer renderer(320, 240, 1);
+    renderer.addObject(&sphere);
+    renderer.update();
+    renderer.render();
+    CHECK(renderer.getStats().frustumCulledObjects == 1);
+    CHECK(renderer.getStats().projectedVertices == 0);
+    CHECK(CountPixels(renderer.getFramebuffer(), MakeColor(255, 255, 255)) == 320 * 240);
+}
+
+// A single triangle, drawn from both sides.
+class TriangleObject : public Object {
+public:
+    TriangleObject(const vec3d& a, const vec3d& b, const vec3d& c) : corners{ a, b, c } {
+        generateVertices();
+        generateIndices();
+        setCullMode(CullMode::None);
+    }
+
+    void generateVertices() override {
+        mesh.vertices.resize(3);
+        for (size_t i = 0; i < 3; ++i) mesh.setVertex(i, corners[i]);
+        mesh.updateBounds();
+    }
+
+    void generateIndices() override { mesh.setIndices({ 0, 1, 2 }); }
+    const Mesh& getMesh() const override { return mesh; }
+
+private:
+    vec3d corners[3];
+    Mesh mesh;
+};
+
+// Whether the triangle (given in clip space) has a point at or beyond the near
+// plane that projects to screen position (sx, sy). depth receives the depth of
+// the triangle's plane there, covered or not. Solves for the barycentric
+// weights b with X - sx W = 0, Y - sy W = 0 and b0 + b1 + b2 = 1.
+static bool CoversUnclipped(const vec4 clip[3], float sx, float sy, float nearW, float& depth) {
+    double m[3][4];
+    for (int i = 0; i < 3; ++i) {
+        m[0][i] = double(clip[i].x) - sx * double(clip[i].w);
+        m[1][i] = double(clip[i].y) - sy * double(clip[i].w);
+        m[2][i] = 1;
+    }
+    m[0][3] = 0; m[1][3] = 0; m[2][3] = 1;
+    for (int col = 0; col < 3; ++col) {
+        int pivot = col;
+        for (int row = col + 1; row < 3; ++row) {
+            if (std::fabs(m[row][col]) > std::fabs(m[pivot][col])) pivot = row;
+        }
+        if (m[pivot][col] == 0) return false;
+        std::swap(m[col], m[pivot]);
+        for (int row = 0; row < 3; ++row) {
+            if (row == col) continue;
+            double f = m[row][col] / m[col][col];
+            for (int k = col; k < 4; ++k) m[row][k] -= f * m[col][k];
+        }
+    }
+    double b[3], w = 0, z = 0;
+    bool inside = true;
+    for (int i = 0; i < 3; ++i) {
+        b[i] = m[i][3] / m[i][i];
+        inside = inside && b[i] >= 0;
+        w += b[i] * clip[i].w;
+        z += b[i] * clip[i].z;
+    }
+    depth = float(z / w);
+    return inside && w >= nearW;
+}
+
+// Triangles crossing the near plane or reaching past the guard band are drawn
+// through the clipper. Every pixel must match an exact, unclipped reference
+// except where the reference itself changes within a fraction of a pixel.
+static void TestTriangleClipping() {
+    const float nearW = 50.0f;
+    const vec3d cases[][3] = {
+        // Tilted through the near plane, which crosses the screen at y ~ 29.
+        { vec3d(-20, -1, -520), vec3d(20, -1, -520), vec3d(0, 30, -400) },
+        // Through the near plane, one corner behind the eye.
+        { vec3d(-100, -50, -600), vec3d(100, -40, 0), vec3d(0, 80, 200) },
+        // Two corners behind the near plane.
+        { vec3d(-30, -20, -530), vec3d(40, -30, -540), vec3d(10, 60, 300) },
+        // Far past the guard band on three sides, entirely in front.
+        { vec3d(-60000, -200, 100), vec3d(60000, -150, 100), vec3d(0, 40000, 300) },
+        // Both at once.
+        { vec3d(-60000, -50, -700), vec3d(60000, -60, 50), vec3d(20, 90, 400) },
+        // Past the guard band, but with a sliver crossing the screen.
+        { vec3d(-50000, -5, 0), vec3d(50000, 5, 0), vec3d(-50000, 20, 0) },
+    };
+    const uint32_t ink = MakeColor(0, 0, 255);
+    for (const auto& corners : cases) {
+        TriangleObject object(corners[0], corners[1], corners[2]);
+        Renderer renderer(160, 120, 0);
+        renderer.getCamera().setNearDistance(nearW);
+        renderer.addObject(&object);
+        renderer.render();
+        CHECK(renderer.getStats().clippedTriangles == 1);
+
+        const mat4 viewProjection = renderer.getCamera().getViewProjection();
+        const vec4 clip[3] = { viewProjection.transformPoint(corners[0]), viewProjection.transformPoint(corners[1]), viewProjection.transformPoint(corners[2]) };
+        const Framebuffer& framebuffer = renderer.getFramebuffer();
+        int covered = 0, ambiguous = 0;
+        for (int y = 0; y < framebuffer.getHeight(); ++y) {
+            for (int x = 0; x < framebuffer.getWidth(); ++x) {
+                float depth, unused;
+                bool expected = CoversUnclipped(clip, x + 0.5f, y + 0.5f, nearW, depth);
+                bool stable = true;
+                for (int corner = 0; corner < 4; ++corner) {
+                    float dx = corner & 1 ? 0.125f : -0.125f, dy = corner & 2 ? 0.125f : -0.125f;
+                    stable = stable && CoversUnclipped(clip, x + 0.5f + dx, y + 0.5f + dy, nearW, unused) == expected;
+                }
+                if (!stable) {
+                    ++ambiguous;
+                    continue;
+                }
+                CHECK((framebuffer.getPixel(x, y) == ink) == expected);
+                if (!expected) continue;
+                ++covered;
+
+                // Clipped vertices lie far off screen or on the near plane,
+                // where depth changes fastest, so accept any depth the plane
+                // takes within a quarter pixel of the centre.
+                float low = depth, high = depth;
+                for (int corner = 0; corner < 4; ++corner) {
+                    float dx = corner & 1 ? 0.25f : -0.25f, dy = corner & 2 ? 0.25f : -0.25f;
+                    float nearby = depth;
+                    CoversUnclipped(clip, x + 0.5f + dx, y + 0.5f + dy, nearW, nearby);
+                    low = std::min(low, nearby);
+                    high = std::max(high, nearby);
+                }
+                float slack = 1e-3f * (1.0f + std::fabs(depth));
+                CHECK(framebuffer.getDepth(x, y) >= low - slack && framebuffer.getDepth(x, y) <= high + slack);
+            }
+        }
+        CHECK(covered > 100);
+        CHECK(ambiguous < framebuffer.getWidth() * 4);
+    }
+}
+
+// Lines reaching past the framebuffer, or split across clip rects, set exactly
+// the pixels an unclipped draw of the same line sets inside the view. The
+// reference draws into a larger framebuffer with the view at an offset.
+static void TestLineClipping() {
+    const int width = 48, height = 40, margin = 300;
+    const uint32_t ink = MakeColor(0, 0, 255);
+    Framebuffer view(width, height), tiled(width, height), reference(width + 2 * margin, height + 2 * margin);
+    const ScreenRect tiles[] = { { 0, 0, 16, 16 }, { 16, 0, 48, 16 }, { 0, 16, 30, 40 }, { 30, 16, 48, 40 } };
+    uint32_t seed = 777;
+    auto next = [&seed](int range) {
+        seed = seed * 1664525u + 1013904223u;
+        return int((seed >> 8) % uint32_t(2 * range + 1)) - range;
+    };
+    for (int line = 0; line < 2000; ++line) {
+        // Mostly lines crossing the view, plus short ones near its edges.
+        int range = line % 4 == 0 ? 12 : margin;
+        int x1 = width / 2 + next(range + width / 2), y1 = height / 2 + next(range + height / 2);
+        int x2 = width / 2 + next(range + width / 2), y2 = height / 2 + next(range + height / 2);
+        if (line % 4 == 0) {
+            x1 = (line % 8 ? width : 0) + next(range);
+            x2 = x1 + next(range);
+        }
+
+        view.clear(0);
+        tiled.clear(0);
+        reference.clear(0);
+        DrawLine(view, x1, y1, x2, y2, ink);
+        for (const ScreenRect& tile : tiles) DrawLine(tiled, x1, y1, x2, y2, ink, tile);
+        DrawLine(reference, x1 + margin, y1 + margin, x2 + margin, y2 + margin, ink);
+
+        int mismatches = 0;
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                uint32_t expected = reference.getPixel(x + margin, y + margin);
+                if (view.getPixel(x, y) != expected || tiled.getPixel(x, y) != expected) ++mismatches;
+            }
+        }
+        CHECK(mismatches == 0);
+    }
+
+    // Endpoints far outside any reference: still no stray pixels off the line's row.
+    view.clear(0);
+    DrawLine(view, -100000, 7, 100000, 7, ink);
+    CHECK(CountPixels(view, ink) == width);
+    for (int x = 0; x < width; ++x) CHECK(view.getPixel(x, 7) == ink);
+}
+
+// Every triangle side belongs to exactly one edge, and interior edges of a
+// closed quad grid are shared by the two triangles on either side.
+static void TestMeshEdges() {
+    const int columns = 5, rows = 3;
+    Mesh mesh;
+    mesh.vertices.resize((columns + 1) * (rows + 1));
+    std::vector<uint32_t> indices;
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < columns; ++x) {
+            uint32_t first = y * (columns + 1) + x, second = first + columns + 1;
+            indices.insert(indices.end(), { first, second, first + 1, second, second + 1, first + 1 });
+        }
+    }
+    mesh.setIndices(indices);
+    const std::vector<MeshEdge>& edges = mesh.getEdges();
+    CHECK(edges.size() == size_t(columns * (rows + 1) + rows * (columns + 1) + columns * rows));
+
+    size_t boundary = 0;
+    for (size_t e = 0; e < edges.size(); ++e) {
+        const MeshEdge& edge = edges[e];
+        CHECK(edge.a < edge.b);
+        if (e > 0) CHECK(edges[e - 1].a < edge.a || (edges[e - 1].a == edge.a && edges[e - 1].b < edge.b));
+        for (uint32_t t : { edge.triangle0, edge.triangle1 }) {
+            if (t == MeshEdge::NoTriangle) {
+                ++boundary;
+                continue;
+            }
+            uint32_t v[3];
+            mesh.getTriangle(t, v[0], v[1], v[2]);
+            CHECK(std::count(v, v + 3, edge.a) == 1 && std::count(v, v + 3, edge.b) == 1);
+        }
+    }
+    CHECK(boundary == size_t(2 * (columns + rows)));
+}
+
+// Anti-aliased lines reaching past the framebuffer, or split across clip
+// rects, blend the same pixels as an unclipped draw into a larger framebuffer
+// around the view. Shifting the coordinates may move the coverage by a
+// rounding step, so channels may differ by one.
+static void TestLineClippingAA() {
+    const int width = 48, height = 40, margin = 300;
+    const uint32_t background = MakeColor(255, 255, 255), ink = MakeColor(0, 0, 255);
+    Framebuffer view(width, height), tiled(width, height), reference(width + 2 * margin, height + 2 * margin);
+    const ScreenRect tiles[] = { { 0, 0, 16, 16 }, { 16, 0, 48, 16 }, { 0, 16, 30, 40 }, { 30, 16, 48, 40 } };
+    uint32_t seed = 4242;
+    auto next = [&seed](float range) {
+        seed = seed * 1664525u + 1013904223u;
+        // Multiples of 1/64, so adding the margin is exact.
+        return std::round((float(seed >> 8) / float(1 << 24) * 2.0f - 1.0f) * range * 64.0f) / 64.0f;
+    };
+    for (int line = 0; line < 2000; ++line) {
+        float range = line % 4 == 0 ? 12.0f : float(margin - 2);
+        float x1 = width / 2 + next(range + width / 2), y1 = height / 2 + next(range + height / 2);
+        float x2 = width / 2 + next(range + width / 2), y2 = height / 2 + next(range + height / 2);
+        if (line % 4 == 0) {
+            x1 = (line % 8 ? width : 0) + next(range);
+            x2 = x1 + next(range);
+        }
+
+        view.clear(background);
+        tiled.clear(background);
+        reference.clear(background);
+        DrawLineAA(view, x1, y1, x2, y2, ink);
+        for (const ScreenRect& tile : tiles) DrawLineAA(tiled, x1, y1, x2, y2, ink, tile);
+        DrawLineAA(reference, x1 + margin, y1 + margin, x2 + margin, y2 + margin, ink);
+
+        int worst = 0;
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                uint32_t expected = reference.getPixel(x + margin, y + margin);
+                worst = std::max({ worst, ChannelDifference(view.getPixel(x, y), expected), ChannelDifference(tiled.getPixel(x, y), expected) });
+            }
+        }
+        CHECK(worst <= 1);
+    }
+}
+
+// Each sample of a multisampled fill lands where a single-sampled fill of the
+// scene shifted by minus that sample's offset puts its pixel centre, so the
+// resolve must equal the per-channel average of those shifted renders.
+// Vertices sit on the rasterizer's 1/16 pixel grid, which makes the shifts
+// exact, and depths are constant per triangle and distinct between them.
+static void TestMultisampling() {
+    const int size = 64, tileSize = 32;
+    const ScreenRect tiles[] = { { 0, 0, 32, 32 }, { 32, 0, 64, 32 }, { 0, 32, 32, 64 }, { 32, 32, 64, 64 } };
+    const uint32_t palette[] = { MakeColor(255, 0, 0), MakeColor(0, 255, 0), MakeColor(0, 0, 255), MakeColor(255, 255, 0), MakeColor(40, 200, 120) };
+    uint32_t seed = 99;
+    auto next = [&seed](int range) {
+        seed = seed * 1664525u + 1013904223u;
+        return int((seed >> 8) % uint32_t(range));
+    };
+    for (int sampleCount : { 4, 8 }) {
+        const int8_t (*pattern)[2] = SampleBuffer::getPattern(sampleCount);
+        const int shift = sampleCount == 8 ? 3 : 2;
+        for (int scene = 0; scene < 20; ++scene) {
+            struct Triangle { vec3d p[3]; uint32_t color; };
+            std::vector<Triangle> triangles(12);
+            for (size_t t = 0; t < triangles.size(); ++t) {
+                float z = float(next(1000) + 1) / 1024.0f;
+                for (vec3d& p : triangles[t].p) p = vec3d(float(next(80 * 16)) / 16.0f - 8.0f, float(next(80 * 16)) / 16.0f - 8.0f, z);
+                triangles[t].color = palette[next(5)];
+            }
+
+            Framebuffer framebuffer(size, size);
+            SampleBuffer samples(size, size, sampleCount, tileSize);
+            framebuffer.clear(MakeColor(255, 255, 255));
+            framebuffer.clearDepth();
+            for (int tile = 0; tile < 4; ++tile) {
+                for (const Triangle& t : triangles) FillTriangle(framebuffer, samples, t.p[0], t.p[1], t.p[2], t.color, tiles[tile]);
+                samples.resolveTile(framebuffer, tile);
+            }
+
+            std::vector<uint32_t> red(size * size, 0), green(size * size, 0), blue(size * size, 0);
+            Framebuffer single(size, size);
+            for (int s = 0; s < sampleCount; ++s) {
+                const vec3d offset(pattern[s][0] / 16.0f, pattern[s][1] / 16.0f, 0.0f);
+                single.clear(MakeColor(255, 255, 255));
+                single.clearDepth();
+                for (const Triangle& t : triangles) FillTriangle(single, t.p[0] - offset, t.p[1] - offset, t.p[2] - offset, t.color);
+                for (int y = 0; y < size; ++y) {
+                    for (int x = 0; x < size; ++x) {
+                        uint32_t color = single.getPixel(x, y);
+                        red[y * size + x] += (color >> 16) & 0xFF;
+                        green[y * size + x] += (color >> 8) & 0xFF;
+                        blue[y * size + x] += color & 0xFF;
+                    }
+                }
+            }
+
+            int mismatches = 0;
+            for (int y = 0; y < size; ++y) {
+                for (int x = 0; x < size; ++x) {
+                    int i = y * size + x;
+                    uint32_t expected = MakeColor(red[i] >> shift, green[i] >> shift, blue[i] >> shift);
+                    if (framebuffer.getPixel(x, y) != expected) ++mismatches;
+                }
+            }
+            CHECK(mismatches == 0);
+        }
+    }
+}
+
+// Every combination of fill mode and sampling the renderer supports.
+struct RenderMode {
+    FillMode fill;
+    bool antialiased;
+    int samples;
+};
+static const RenderMode RenderModes[] = {
+    { FillMode::Solid, false, 1 },
+    { FillMode::Solid, false, 4 },
+    { FillMode::Solid, false, 8 },
+    { FillMode::Wireframe, false, 1 },
+    { FillMode::Wireframe, true, 1 },
+};
+
+static void ApplyRenderMode(Renderer& renderer, const RenderMode& mode) {
+    renderer.setFillMode(mode.fill);
+    renderer.setLineAntialiasing(mode.antialiased);
+    renderer.setMultisampling(mode.samples);
+}
+
+// Tiles only partition the work: any valid tile size draws the same image.
+static void TestTileSizes() {
+    Sphere large(150.0f, 20, 30), small(60.0f, 8, 12);
+    const int sizes[] = { Renderer::MaxTileSize, Renderer::DefaultTileSize, 24, 8 };
+    for (const RenderMode& mode : RenderModes) {
+        std::vector<std::unique_ptr<Renderer>> renderers;
+        for (int size : sizes) {
+            renderers.push_back(std::make_unique<Renderer>(1280, 960, 2));
+            renderers.back()->setTileSize(size);
+            CHECK(renderers.back()->getTileSize() == size);
+            ApplyRenderMode(*renderers.back(), mode);
+            renderers.back()->addObject(&large);
+            renderers.back()->addObject(&small);
+        }
+        for (int frame = 0; frame < 3; ++frame) {
+            for (auto& renderer : renderers) {
+                renderer->update();
+                renderer->render();
+            }
+            for (size_t i = 1; i < renderers.size(); ++i) {
+                CHECK(CountDifferences(renderers[0]->getFramebuffer(), renderers[i]->getFramebuffer()) == 0);
+                CHECK(CountDepthDifferences(renderers[0]->getFramebuffer(), renderers[i]->getFramebuffer()) == 0);
+            }
+        }
+    }
+
+    Renderer renderer(64, 64, 0);
+    for (int size : { 0, 12, Renderer::MaxTileSize + Framebuffer::CoarseBlockSize }) {
+        CHECK(!Renderer::isValidTileSize(size));
+        renderer.setTileSize(size);
+        CHECK(renderer.getTileSize() == Renderer::DefaultTileSize);
+    }
+}
+
+// Only 1, 4 and 8 samples are accepted; anything else, or the current count,
+// leaves the renderer as it is and does not force a redraw.
+static void TestSampleCounts() {
+    Sphere sphere(150.0f, 8, 12);
+    Renderer renderer(256, 256, 0);
+    renderer.addObject(&sphere);
+    renderer.setMultisampling(4);
+    renderer.render();
+    for (int count : { -1, 0, 2, 3, 4, 16 }) {
+        CHECK(Renderer::isValidSampleCount(count) == (count == 4));
+        renderer.setMultisampling(count);
+        CHECK(renderer.getMultisampling() == 4);
+        renderer.render();
+        CHECK(renderer.getStats().dirtyTiles == 0);
+    }
+    for (int count : { 8, 1 }) {
+        renderer.setMultisampling(count);
+        CHECK(renderer.getMultisampling() == count);
+        renderer.render();
+        CHECK(renderer.getStats().dirtyTiles == size_t(4 * 4));
+    }
+}
+
+// Streamed fills write the same values as cached ones for every start
+// alignment and length, including the unaligned head and the tail.
+static void TestStreamingFill() {
+    AlignedBuffer<uint32_t, Framebuffer::Alignment> buffer(64);
+    for (size_t offset = 0; offset < 8; ++offset) {
+        for (size_t count = 0; count + offset <= 48; ++count) {
+            std::fill(buffer.get(), buffer.get() + buffer.size(), 0u);
+            StreamSpan(buffer.get() + offset, count, 0xABCDEF01u);
+            StreamFence();
+            for (size_t i = 0; i < buffer.size(); ++i) CHECK(buffer[i] == (i >= offset && i < offset + count ? 0xABCDEF01u : 0u));
+        }
+    }
+
+    Framebuffer streamed(37, 21), cached(37, 21);
+    const ScreenRect rect = { 3, 2, 30, 19 };
+    for (Framebuffer* framebuffer : { &streamed, &cached }) {
+        framebuffer->clear(0);
+        framebuffer->clearDepth(0.0f);
+    }
+    streamed.fill(rect, 0x123456u, Framebuffer::Store::Streaming);
+    streamed.fillDepth(rect, 0.5f, Framebuffer::Store::Streaming);
+    cached.fill(rect, 0x123456u);
+    cached.fillDepth(rect, 0.5f);
+    CHECK(CountDifferences(streamed, cached) == 0);
+    CHECK(CountDepthDifferences(streamed, cached) == 0);
+}
+
+// Skipping the clear of tiles that still hold it changes nothing: a renderer
+// that drops its fast-clear state before every frame draws the same frames,
+// including when the fill mode changes between frames.
+static void TestFastClear() {
+    Sphere sphere(150.0f, 20, 30);
+    Renderer fast(1280, 960, 2), full(1280, 960, 2);
+    const Renderer& fastView = fast;
+    fast.addObject(&sphere);
+    full.addObject(&sphere);
+    const size_t modeCount = sizeof(RenderModes) / sizeof(RenderModes[0]);
+    for (size_t frame = 0; frame < 4 * modeCount; ++frame) {
+        // Each mode for a few frames, then a different mode every frame.
+        const RenderMode& mode = RenderModes[frame < 3 * modeCount ? frame / 3 : frame % modeCount];
+        for (Renderer* renderer : { &fast, &full }) {
+            ApplyRenderMode(*renderer, mode);
+            renderer->update();
+        }
+        full.getFramebuffer();
+        fast.render();
+        full.render();
+        CHECK(full.getStats().fastClearedTiles == 0);
+        if (frame > 0) CHECK(fast.getStats().fastClearedTiles > 0);
+        CHECK(CountDifferences(fastView.getFramebuffer(), full.getFramebuffer()) == 0);
+        CHECK(CountDepthDifferences(fastView.getFramebuffer(), full.getFramebuffer()) == 0);
+    }
+}
+
+// Redrawing only dirty tiles gives the same color and depth, frame by frame,
+// as a renderer invalidated before every frame: with the whole scene
+// animated, with one object turning in large steps next to a still one, and
+// with nothing moving, in every fill and sampling mode.
+static void TestDirtyTracking() {
+    enum class Animation { All, One, None };
+    for (Animation animation : { Animation::All, Animation::One, Animation::None }) {
+        for (const RenderMode& mode : RenderModes) {
+            Sphere sphere(150.0f, 20, 30);
+            TriangleObject turning(vec3d(200, 0, -100), vec3d(420, 60, -100), vec3d(260, 220, -100));
+            Renderer tracked(1280, 960, 2), full(1280, 960, 2);
+            const Renderer& trackedView = tracked;
+            for (Renderer* renderer : { &tracked, &full }) {
+                renderer->addObject(&sphere);
+                renderer->addObject(&turning);
+                ApplyRenderMode(*renderer, mode);
+            }
+            const size_t tiles = size_t((1280 + tracked.getTileSize() - 1) / tracked.getTileSize()) * ((960 + tracked.getTileSize() - 1) / tracked.getTileSize());
+            for (int frame = 0; frame < 6; ++frame) {
+                if (animation == Animation::All) {
+                    tracked.update();
+                    full.update();
+                } else if (animation == Animation::One) {
+                    turning.rotate(0.0f, 0.0f, 0.8f * (frame + 1));
+                }
+                full.invalidate();
+                tracked.render();
+                full.render();
+                CHECK(CountDifferences(trackedView.getFramebuffer(), full.getFramebuffer()) == 0);
+                CHECK(CountDepthDifferences(trackedView.getFramebuffer(), full.getFramebuffer()) == 0);
+                if (frame == 0) continue;
+                if (animation == Animation::One) CHECK(tracked.getStats().dirtyTiles > 0 && tracked.getStats().dirtyTiles < tiles);
+                if (animation == Animation::None) CHECK(tracked.getStats().dirtyTiles == 0);
+            }
+        }
+    }
+}
+
+// FrameLoop's stepping, driven through advance() with chosen frame times.
+// A step of 1/64 s and times in 1/1024 s keep the arithmetic exact.
+static void TestFrameLoop() {
+    const double step = 1.0 / 64.0;
+    FrameLoop loop(step);
+    double elapsed = 0;
+    int steps = 0;
+    uint32_t seed = 5;
+    for (int frame = 0; frame < 500; ++frame) {
+        // 1 to 48 ms: below one step up to three steps in one frame.
+        seed = seed * 1664525u + 1013904223u;
+        double seconds = double((seed >> 8) % 48 + 1) / 1024.0;
+        elapsed += seconds;
+        steps += loop.advance(seconds);
+        CHECK(loop.getFrameSeconds() == seconds);
+        CHECK(steps == int(elapsed / step));
+        CHECK(loop.getAlpha() >= 0.0f && loop.getAlpha() <= 1.0f);
+        CHECK(loop.getAlpha() == float((elapsed - steps * step) / step));
+    }
+
+    // A stall runs the cap and drops the rest instead of catching up later.
+    loop.reset();
+    CHECK(loop.advance(8.5 * step) == 8);
+    CHECK(loop.advance(1.0) == 8);
+    CHECK(loop.getAlpha() == 0.0f);
+    CHECK(loop.advance(0.5 * step) == 0);
+    CHECK(loop.getAlpha() == 0.5f);
+    CHECK(loop.advance(0.75 * step) == 1);
+    CHECK(loop.getAlpha() == 0.25f);
+
+    FrameLoop capped(step, 3);
+    CHECK(capped.advance(10 * step) == 3);
+    CHECK(capped.advance(0) == 0);
+    CHECK(capped.getAlpha() == 0.0f);
+
+    // The frame-rate limit waits out the interval on the real clock.
+    FrameLoop limited(step);
+    limited.setFrameRateLimit(200.0);
+    limited.beginFrame();
+    limited.beginFrame();
+    CHECK(limited.getFrameSeconds() >= 1.0 / 200.0);
+}
+
+// A pipelined renderer draws the same frames, in the same order, as update()
+// then render() on the caller, at every depth and in every fill mode.
+static void TestFramePipeline() {
+    const int frames = 6;
+    Sphere sphere(150.0f, 20, 30);
+    TriangleObject turning(vec3d(200, 0, -100), vec3d(420, 60, -100), vec3d(260, 220, -100));
+    for (const RenderMode& mode : RenderModes) {
+        std::vector<std::vector<uint32_t>> expected;
+        Renderer serial(1280, 960, 2);
+        serial.addObject(&sphere);
+        serial.addObject(&turning);
+        ApplyRenderMode(serial, mode);
+        for (int frame = 0; frame < frames; ++frame) {
+            serial.update();
+            turning.rotate(0.0f, 0.0f, 0.3f * frame);
+            serial.render();
+            const Framebuffer& framebuffer = static_cast<const Renderer&>(serial).getFramebuffer();
+            std::vector<uint32_t> pixels;
+            for (int y = 0; y < framebuffer.getHeight(); ++y) pixels.insert(pixels.end(), framebuffer.getRow(y), framebuffer.getRow(y) + framebuffer.getWidth());
+            expected.push_back(std::move(pixels));
+        }
+
+        for (int depth = 1; depth <= FramePipeline::MaxDepth; ++depth) {
+            Renderer renderer(1280, 960, 2);
+            renderer.addObject(&sphere);
+            renderer.addObject(&turning);
+            ApplyRenderMode(renderer, mode);
+            int simulated = 0, presented = 0;
+            FramePipeline pipeline(renderer, [&](FrameSnapshot& snapshot) {
+                renderer.update();
+                turning.rotate(0.0f, 0.0f, 0.3f * simulated++);
+                renderer.capture(snapshot);
+            }, depth);
+            CHECK(pipeline.getDepth() == depth);
+            for (int frame = 0; frame < frames; ++frame) {
+                pipeline.renderFrame([&](Renderer& drawn) {
+                    const Framebuffer& framebuffer = static_cast<const Renderer&>(drawn).getFramebuffer();
+                    int mismatches = 0;
+                    for (int y = 0; y < framebuffer.getHeight(); ++y) {
+                        for (int x = 0; x < framebuffer.getWidth(); ++x) {
+                            if (framebuffer.getPixel(x, y) != expected[presented][size_t(y) * framebuffer.getWidth() + x]) ++mismatches;
+                        }
+                    }
+                    CHECK(mismatches == 0);
+                    ++presented;
+                });
+            }
+            CHECK(presented == frames);
+        }
+    }
+}
+
+// Just enough JSON to read back the profiler's trace: parse() fails on any
+// syntax error or trailing text instead of guessing.
+struct JsonValue {
+    enum class Type { Null, Bool, Number, String, Array, Object } type = Type::Null;
+    double number = 0;
+    std::string text;
+    std::vector<JsonValue> items;
+    std::vector<std::pair<std::string, JsonValue>> members;
+
+    const JsonValue* get(const std::string& key) const {
+        for (const auto& member : members) {
+            if (member.first == key) return &member.second;
+        }
+        return nullptr;
+    }
+};
+
+class JsonParser {
+public:
+    explicit JsonParser(const std::string& source) : source(source) {}
+
+    bool parse(JsonValue& value) {
+        if (!parseValue(value)) return false;
+        skipSpace();
+        return pos == source.size();
+    }
+
+private:
+    const std::string& source;
+    size_t pos = 0;
+
+    void skipSpace() {
+        while (pos < source.size() && std::isspace((unsigned char)source[pos])) ++pos;
+    }
+
+    bool consume(char c) {
+        skipSpace();
+        if (pos >= source.size() || source[pos] != c) return false;
+        ++pos;
+        return true;
+    }
+
+    bool parseString(std::string& text) {
+        if (!consume('"')) return false;
+        while (pos < source.size() && source[pos] != '"') {
+            if (source[pos] == '\\' && ++pos >= source.size()) return false;
+            text += source[pos++];
+        }
+        return consume('"');
+    }
+
+    bool parseValue(JsonValue& value) {
+        skipSpace();
+        if (pos >= source.size()) return false;
+        char c = source[pos];
+        if (c == '{') {
+            value.type = JsonValue::Type::Object;
+            ++pos;
+            if (consume('}')) return true;
+            do {
+                std::pair<std::string, JsonValue> member;
+                if (!parseString(member.first) || !consume(':') || !parseValue(member.second)) return false;
+                value.members.push_back(std::move(member));
+            } while (consume(','));
+            return consume('}');
+        }
+        if (c == '[') {
+            value.type = JsonValue::Type::Array;
+            ++pos;
+            if (consume(']')) return true;
+            do {
+                value.items.emplace_back();
+                if (!parseValue(value.items.back())) return false;
+            } while (consume(','));
+            return consume(']');
+        }
+        if (c == '"') {
+            value.type = JsonValue::Type::String;
+            return parseString(value.text);
+        }
+        for (const char* word : { "true", "false", "null" }) {
+            if (source.compare(pos, std::strlen(word), word) == 0) {
+                value.type = word[0] == 'n' ? JsonValue::Type::Null : JsonValue::Type::Bool;
+                value.number = word[0] == 't';
+                pos += std::strlen(word);
+                return true;
+            }
+        }
+        char* end = nullptr;
+        value.type = JsonValue::Type::Number;
+        value.number = std::strtod(source.c_str() + pos, &end);
+        if (end == source.c_str() + pos) return false;
+        pos = size_t(end - source.c_str());
+        return true;
+    }
+};
+
+// Writes the profiler's Chrome trace to a scratch file and parses it back.
+static bool LoadChromeTrace(JsonValue& trace) {
+    const std::string path = "EngineTests_trace.json";
+    if (!Profiler::writeChromeTrace(path)) return false;
+    std::ifstream file(path);
+    std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+    std::remove(path.c_str());
+    return JsonParser(source).parse(trace);
+}
+
+// The Chrome trace is valid JSON that holds every recorded event on its
+// thread's named track, and the summary's percentiles use nearest rank:
+// frames and stages of 1..100 ms give p50 50, p95 95, p99 99 and max 100.
+static void TestProfiler() {
+    const uint64_t millisecond = 1000000;
+    Profiler::reset();
+    Profiler::setEnabled(true);
+    Profiler::setThreadName("test main");
+    for (int k = 1; k <= 100; ++k) {
+        // Out of order, so the percentiles have to sort.
+        int ms = (k * 37) % 100 + 1;
+        Profiler::record("test stage", 1000 * millisecond, (1000 + ms) * millisecond);
+        Profiler::recordFrame(ms / 1000.0);
+    }
+    std::thread worker([] {
+        Profiler::setThreadName("test \"worker\"");
+        Profiler::record("test worker stage", Profiler::now(), Profiler::now());
+    });
+    worker.join();
+
+    JsonValue trace;
+    CHECK(LoadChromeTrace(trace));
+    const JsonValue* events = trace.get("traceEvents");
+    CHECK(events && events->type == JsonValue::Type::Array);
+    if (events) {
+        double mainTid = -1, workerTid = -1;
+        for (const JsonValue& event : events->items) {
+            const JsonValue* phase = event.get("ph");
+            const JsonValue* args = event.get("args");
+            if (phase && phase->text == "M" && args && args->get("name")) {
+                if (args->get("name")->text == "test main") mainTid = event.get("tid")->number;
+                if (args->get("name")->text == "test \"worker\"") workerTid = event.get("tid")->number;
+            }
+        }
+        CHECK(mainTid >= 0 && workerTid >= 0 && mainTid != workerTid);
+
+        int stageEvents = 0, workerEvents = 0;
+        double totalDuration = 0;
+        for (const JsonValue& event : events->items) {
+            const JsonValue* name = event.get("name");
+            if (!name || event.get("ph")->text != "X") continue;
+            if (name->text == "test stage") {
+                ++stageEvents;
+                CHECK(event.get("tid")->number == mainTid);
+                CHECK_NEAR(event.get("ts")->number, 1000000.0, 1e-3);
+                totalDuration += event.get("dur")->number;
+            } else if (name->text == "test worker stage") {
+                ++workerEvents;
+                CHECK(event.get("tid")->number == workerTid);
+            }
+        }
+        CHECK(stageEvents == 100);
+        CHECK(workerEvents == 1);
+        // 1 + 2 + ... + 100 ms, in microseconds.
+        CHECK_NEAR(totalDuration, 5050000.0, 1e-3);
+    }
+
+    std::ostringstream summary;
+    Profiler::printSummary(summary);
+    std::istringstream lines(summary.str());
+    std::string line;
+    int checkedRows = 0;
+    while (std::getline(lines, line)) {
+        bool frameRow = line.compare(0, 6, "frame ") == 0, stageRow = line.compare(0, 11, "test stage ") == 0;
+        if (!frameRow && !stageRow) continue;
+        std::istringstream row(line.substr(frameRow ? 6 : 11));
+        size_t count = 0;
+        double p50 = 0, p95 = 0, p99 = 0, max = 0;
+        CHECK(bool(row >> count >> p50 >> p95 >> p99 >> max));
+        CHECK(count == 100);
+        CHECK_NEAR(p50, 50.0, 1e-3);
+        CHECK_NEAR(p95, 95.0, 1e-3);
+        CHECK_NEAR(p99, 99.0, 1e-3);
+        CHECK_NEAR(max, 100.0, 1e-3);
+        ++checkedRows;
+    }
+    CHECK(checkedRows == 2);
+
+    Profiler::setEnabled(false);
+    Profiler::reset();
+}
+
+// Threads that come and go reuse the buffers of finished ones instead of
+// adding a track each, and the summary keeps only the last FramesKept frames.
+static void TestProfilerLimits() {
+    Profiler::reset();
+    Profiler::setEnabled(true);
+    for (int i = 0; i < 50; ++i) {
+        std::thread([] {
+            Profiler::setThreadName("short-lived");
+            Profiler::record("short-lived stage", Profiler::now(), Profiler::now());
+        }).join();
+    }
+    JsonValue trace;
+    CHECK(LoadChromeTrace(trace));
+    int tracks = 0, events = 0;
+    if (const JsonValue* items = trace.get("traceEvents")) {
+        for (const JsonValue& event : items->items) {
+            const JsonValue* args = event.get("args");
+            if (args && args->get("name") && args->get("name")->text == "short-lived") ++tracks;
+            if (event.get("name")->text == "short-lived stage") ++events;
+        }
+    }
+    CHECK(tracks == 1);
+    CHECK(events == 1);
+
+    // Old slow frames fall out of the ring.
+    for (int i = 0; i < 100; ++i) Profiler::recordFrame(1.0);
+    for (size_t i = 0; i < Profiler::FramesKept; ++i) Profiler::recordFrame(0.002);
+    std::ostringstream summary;
+    Profiler::printSummary(summary);
+    std::istringstream lines(summary.str());
+    std::string line;
+    bool found = false;
+    while (std::getline(lines, line)) {
+        if (line.compare(0, 6, "frame ") != 0) continue;
+        std::istringstream row(line.substr(6));
+        size_t count = 0;
+        double p50 = 0, p95 = 0, p99 = 0, max = 0;
+        CHECK(bool(row >> count >> p50 >> p95 >> p99 >> max));
+        CHECK(count == Profiler::FramesKept);
+        CHECK_NEAR(max, 2.0, 1e-3);
+        found = true;
+    }
+    CHECK(found);
+
+    Profiler::setEnabled(false);
+    Profiler::reset();
+}
+
+int main() {
+    struct Test {
+        const char* name;
+        void (*run)();
+    };
+    const Test tests[] = {
+        { "framebuffer rows", TestFramebufferRows },
+        { "line endpoints", TestLineEndpoints },
+        { "thread pool", TestThreadPool },
+        { "job graph ordering", TestJobGraphOrdering },
+        { "mesh indices", TestMeshIndices },
+        { "vertex kernels", TestVertexKernels },
+        { "rest pose transform", TestRestPoseTransform },
+        { "quat matches euler", TestQuatMatchesEuler },
+        { "mat4 multiply and inverse", TestMat4MultiplyInverse },
+        { "mvp matches legacy projection", TestMvpMatchesLegacyProjection },
+        { "projection cache", TestProjectionCache },
+        { "fill rule", TestFillRule },
+        { "fill shared edges", TestFillSharedEdges },
+        { "depth ordering", TestDepthOrdering },
+        { "coarse depth", TestCoarseDepth },
+        { "occlusion culling", TestOcclusionCulling },
+        { "back-face culling", TestBackFaceCulling },
+        { "frustum", TestFrustum },
+        { "frustum culling", TestFrustumCulling },
+        { "triangle clipping", TestTriangleClipping },
+        { "line clipping", TestLineClipping },
+        { "mesh edges", TestMeshEdges },
+        { "anti-aliased line clipping", TestLineClippingAA },
+        { "multisampling", TestMultisampling },
+        { "tile sizes", TestTileSizes },
+        { "sample counts", TestSampleCounts },
+        { "streaming fill", TestStreamingFill },
+        { "fast clear", TestFastClear },
+        { "dirty tracking", TestDirtyTracking },
+        { "frame loop", TestFrameLoop },
+        { "frame pipeline", TestFramePipeline },
+        { "profiler", TestProfiler },
+        { "profiler limits", TestProfilerLimits },
+    };
+
+    int failedTests = 0;
+    for (const Test& test : tests) {
+        int before = failedChecks;
+        test.run();
+        bool passed = failedChecks == before;
+        if (!passed) ++failedTests;
+        std::cout << (passed ? "ok      " : "FAILED  ") << test.name << std::endl;
+    }
+    std::cout << failedTests << " of " << sizeof(tests) / sizeof(tests[0]) << " tests failed" << std::endl;
+    return failedTests ? EXIT_FAILURE : EXIT_SUCCESS;
+}
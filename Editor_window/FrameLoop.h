@@ -0,0 +1,78 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+// Fixed-timestep pacing for a render loop, on the high-resolution steady clock.
+// The simulation advances in whole steps of a fixed length however fast or
+// slowly frames come; each frame is then drawn getAlpha() of the way from the
+// previous step to the latest one. A frame that arrives very late runs at most
+// maxStepsPerFrame steps and drops the rest, so a stall cannot snowball.
+class FrameLoop {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit FrameLoop(double stepSeconds, int maxStepsPerFrame = 8)
+        : step(stepSeconds), maxSteps(maxStepsPerFrame) {
+        reset();
+    }
+
+    // Frames per second to pace beginFrame() to; 0 renders as fast as possible.
+    void setFrameRateLimit(double framesPerSecond) { frameInterval = framesPerSecond > 0 ? 1.0 / framesPerSecond : 0.0; }
+
+    // Restarts the clock with no simulation time owed.
+    void reset() {
+        lastFrame = Clock::now();
+        accumulator = 0;
+        frameSeconds = 0;
+        alpha = 1.0f;
+    }
+
+    // Call at the top of every frame. Waits out the frame-rate limit, then
+    // returns how many simulation steps are due before drawing.
+    int beginFrame() {
+        Clock::time_point now = Clock::now();
+        if (frameInterval > 0) {
+            Clock::time_point due = lastFrame + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(frameInterval));
+            // Sleep granularity can be a whole scheduler tick; sleep for most of
+            // the wait and yield through the rest.
+            if (due - now > SpinWindow) std::this_thread::sleep_until(due - SpinWindow);
+            while ((now = Clock::now()) < due) std::this_thread::yield();
+        }
+        double elapsed = std::chrono::duration<double>(now - lastFrame).count();
+        lastFrame = now;
+        return advance(elapsed);
+    }
+
+    // The clock-free part of beginFrame(): owes the simulation elapsedSeconds
+    // more and returns the steps now due.
+    int advance(double elapsedSeconds) {
+        frameSeconds = elapsedSeconds;
+        accumulator += elapsedSeconds;
+        int steps = (int)(accumulator / step);
+        accumulator -= steps * step;
+        if (steps > maxSteps) {
+            steps = maxSteps;
+            accumulator = 0;
+        }
+        alpha = (float)std::min(accumulator / step, 1.0);
+        return steps;
+    }
+
+    // Blend from the previous step to the latest one for this frame's drawing.
+    float getAlpha() const { return alpha; }
+    // Wall time between the last two beginFrame() calls.
+    double getFrameSeconds() const { return frameSeconds; }
+    double getStepSeconds() const { return step; }
+
+private:
+    static constexpr std::chrono::milliseconds SpinWindow{ 2 };
+
+    double step;
+    int maxSteps;
+    double frameInterval = 0;
+    Clock::time_point lastFrame;
+    double accumulator = 0;
+    double frameSeconds = 0;
+    float alpha = 1.0f;
+};
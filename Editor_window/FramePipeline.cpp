@@ -0,0 +1,96 @@
+#include "FramePipeline.h"
+#include <algorithm>
+#include "Profiler.h"
+
+FramePipeline::FramePipeline(Renderer& renderer, Simulate simulate, int depth)
+    : renderer(renderer), simulate(std::move(simulate)), slots(std::min(std::max(depth, 1), MaxDepth)) {
+    if (slots.size() > 1) {
+        simulation = std::thread(&FramePipeline::simulationLoop, this);
+    }
+}
+
+FramePipeline::~FramePipeline() {
+    if (!simulation.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    slotFree.notify_all();
+    simulation.join();
+}
+
+void FramePipeline::renderFrame(const Present& present) {
+    Clock::time_point frameStart = Clock::now();
+    if (slots.size() == 1) {
+        Slot& slot = slots[0];
+        {
+            ENGINE_PROFILE_SCOPE("simulate");
+            simulate(slot.snapshot);
+        }
+        slot.captured = Clock::now();
+        renderer.render(slot.snapshot);
+        present(renderer);
+        finishFrame(frameStart, slot.captured);
+        return;
+    }
+
+    Slot* slot;
+    {
+        ENGINE_PROFILE_SCOPE("wait for simulation");
+        std::unique_lock<std::mutex> lock(mutex);
+        frameReady.wait(lock, [this]() { return simulated > rendered; });
+        slot = &slots[rendered % slots.size()];
+        stats.renderWait += std::chrono::duration<double>(Clock::now() - frameStart).count();
+    }
+    renderer.render(slot->snapshot);
+    Clock::time_point captured = slot->captured;
+    // Presenting reads the framebuffer, not the snapshot, so the slot can be reused already.
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++rendered;
+    }
+    slotFree.notify_one();
+    present(renderer);
+    finishFrame(frameStart, captured);
+}
+
+PipelineStats FramePipeline::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+void FramePipeline::simulationLoop() {
+    Profiler::setThreadName("simulation");
+    for (;;) {
+        Clock::time_point waitStart = Clock::now();
+        Slot* slot;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            slotFree.wait(lock, [this]() { return stopping || simulated - rendered < slots.size(); });
+            if (stopping) return;
+            slot = &slots[simulated % slots.size()];
+            stats.simulationWait += std::chrono::duration<double>(Clock::now() - waitStart).count();
+        }
+        {
+            ENGINE_PROFILE_SCOPE("simulate");
+            simulate(slot->snapshot);
+        }
+        slot->captured = Clock::now();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++simulated;
+        }
+        frameReady.notify_one();
+    }
+}
+
+void FramePipeline::finishFrame(Clock::time_point frameStart, Clock::time_point captured) {
+    Clock::time_point end = Clock::now();
+    Profiler::recordFrame(std::chrono::duration<double>(end - frameStart).count());
+    double latency = std::chrono::duration<double>(end - captured).count();
+    std::lock_guard<std::mutex> lock(mutex);
+    ++stats.frames;
+    stats.lastLatency = latency;
+    stats.totalLatency += latency;
+    stats.maxLatency = std::max(stats.maxLatency, latency);
+}
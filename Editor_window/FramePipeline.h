@@ -0,0 +1,77 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Renderer.h"
+
+// Latency and stall counters of a FramePipeline, in seconds.
+struct PipelineStats {
+    size_t frames = 0;
+    // From the capture of a frame's snapshot to the end of its presentation:
+    // how old the scene state on screen is once it gets there.
+    double lastLatency = 0, totalLatency = 0, maxLatency = 0;
+    // Time the render side spent waiting for a simulated frame (simulation
+    // bound), and the simulation side waiting for a free snapshot (render bound).
+    double renderWait = 0, simulationWait = 0;
+
+    double getAverageLatency() const { return frames ? totalLatency / frames : 0; }
+};
+
+// Runs the scene side of frames ahead of the render side. Each frame goes
+// through simulate (advance and pose the scene, then capture it) and render
+// plus present; the simulate callback gets the frame's snapshot to capture
+// into. depth snapshots rotate between the two sides:
+//   1  both stages run back to back on the caller, as Renderer::render() does;
+//   2  the next frame is simulated on the pipeline's thread while the current
+//      one is rasterized and presented;
+//   3+ the simulation may run further ahead, which absorbs uneven stage times
+//      at the cost of one more frame of latency per snapshot.
+// Only the simulate callback may touch the scene (objects, camera,
+// Renderer::update()) while the pipeline exists; render settings belong to
+// the thread calling renderFrame().
+class FramePipeline {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Simulate = std::function<void(FrameSnapshot&)>;
+    using Present = std::function<void(Renderer&)>;
+    static constexpr int MaxDepth = 4;
+
+    // depth is clamped to 1..MaxDepth. Above 1, simulation starts right away.
+    FramePipeline(Renderer& renderer, Simulate simulate, int depth = 2);
+    ~FramePipeline();
+
+    FramePipeline(const FramePipeline&) = delete;
+    FramePipeline& operator=(const FramePipeline&) = delete;
+
+    // Draws the oldest simulated frame and hands the renderer to present once
+    // the frame is in its framebuffer.
+    void renderFrame(const Present& present);
+
+    int getDepth() const { return (int)slots.size(); }
+    PipelineStats getStats() const;
+
+private:
+    struct Slot {
+        FrameSnapshot snapshot;
+        Clock::time_point captured;
+    };
+
+    void simulationLoop();
+    // Records the latency of a frame, and its time in renderFrame() with the profiler.
+    void finishFrame(Clock::time_point frameStart, Clock::time_point captured);
+
+    Renderer& renderer;
+    Simulate simulate;
+    std::vector<Slot> slots;
+    // Frames captured so far, and frames whose snapshot has been drawn and handed back.
+    uint64_t simulated = 0, rendered = 0;
+    mutable std::mutex mutex;
+    std::condition_variable frameReady, slotFree;
+    bool stopping = false;
+    PipelineStats stats;
+    std::thread simulation;
+};
@@ -0,0 +1,254 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+#include "AlignedBuffer.h"
+
+// ENGINE_FORCE_SCALAR keeps the scalar fill paths, so tests can check them on any host.
+#if !defined(ENGINE_FORCE_SCALAR) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define ENGINE_FILL_SSE2 1
+#elif !defined(ENGINE_FORCE_SCALAR) && (defined(__aarch64__) || defined(_M_ARM64))
+#include <arm_neon.h>
+#define ENGINE_FILL_NEON 1
+#endif
+
+// Pixels are 32bpp 0x00RRGGBB, which is the in-memory layout of a top-down
+// 32-bit DIB, so the window backend can present the buffer with a single blit.
+inline uint32_t MakeColor(uint8_t r, uint8_t g, uint8_t b) {
+    return (uint32_t(r) << 16) | (uint32_t(g) << 8) | uint32_t(b);
+}
+
+// Sets count 32-bit elements starting at dst, eight per iteration once dst is
+// 16-byte aligned. Used for both color and depth rows.
+template <typename T>
+inline void FillSpan(T* dst, size_t count, T value) {
+    static_assert(sizeof(T) == 4, "FillSpan writes 32-bit elements");
+    size_t i = 0;
+    for (; i < count && (reinterpret_cast<uintptr_t>(dst + i) & 15) != 0; ++i) dst[i] = value;
+#if defined(ENGINE_FILL_SSE2) || defined(ENGINE_FILL_NEON)
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+#if defined(ENGINE_FILL_SSE2)
+    __m128i pattern = _mm_set1_epi32((int)bits);
+    for (; i + 8 <= count; i += 8) {
+        _mm_store_si128(reinterpret_cast<__m128i*>(dst + i), pattern);
+        _mm_store_si128(reinterpret_cast<__m128i*>(dst + i + 4), pattern);
+    }
+#else
+    uint32x4_t pattern = vdupq_n_u32(bits);
+    for (; i + 8 <= count; i += 8) {
+        vst1q_u32(reinterpret_cast<uint32_t*>(dst + i), pattern);
+        vst1q_u32(reinterpret_cast<uint32_t*>(dst + i + 4), pattern);
+    }
+#endif
+#endif
+    for (; i < count; ++i) dst[i] = value;
+}
+
+// FillSpan with non-temporal stores where SSE2 has them: the written lines go
+// straight to memory instead of displacing cached data, for fills nothing reads
+// again soon. Streamed stores are weakly ordered: finish a run of them with
+// StreamFence() before the memory is handed to another thread.
+template <typename T>
+inline void StreamSpan(T* dst, size_t count, T value) {
+#if defined(ENGINE_FILL_SSE2)
+    static_assert(sizeof(T) == 4, "StreamSpan writes 32-bit elements");
+    size_t i = 0;
+    for (; i < count && (reinterpret_cast<uintptr_t>(dst + i) & 15) != 0; ++i) dst[i] = value;
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    __m128i pattern = _mm_set1_epi32((int)bits);
+    for (; i + 8 <= count; i += 8) {
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i), pattern);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i + 4), pattern);
+    }
+    for (; i < count; ++i) dst[i] = value;
+#else
+    FillSpan(dst, count, value);
+#endif
+}
+
+inline void StreamFence() {
+#if defined(ENGINE_FILL_SSE2)
+    _mm_sfence();
+#endif
+}
+
+// Pixel rectangle with exclusive right/bottom edges, like a Win32 RECT.
+struct ScreenRect {
+    int left, top, right, bottom;
+
+    int getWidth() const { return right - left; }
+    int getHeight() const { return bottom - top; }
+    bool contains(int x, int y) const { return x >= left && x < right && y >= top && y < bottom; }
+};
+
+// Color plus a 32-bit float depth plane with the same pitch. Smaller depth is
+// nearer; the depth plane clears to FarDepth.
+//
+// A coarse depth plane keeps, per CoarseBlockSize square block, an upper bound
+// on the depths stored in that block. Anything whose nearest depth is not in
+// front of that bound is hidden there, which isOccluded() answers for a whole
+// rectangle without touching per-pixel depth.
+class Framebuffer {
+public:
+    static constexpr int Alignment = 32;
+    static constexpr int PixelsPerAlignment = Alignment / sizeof(uint32_t);
+    static constexpr float FarDepth = std::numeric_limits<float>::infinity();
+    static constexpr int CoarseBlockSize = 8;
+
+    // How fills write memory: Cached for regions that are drawn right after,
+    // Streaming for regions nothing reads before the frame is presented.
+    enum class Store {
+        Cached,
+        Streaming,
+    };
+
+    Framebuffer(int width, int height) {
+        resize(width, height);
+    }
+
+    void resize(int newWidth, int newHeight) {
+        width = std::max(newWidth, 0);
+        height = std::max(newHeight, 0);
+        // Round every row up to a whole alignment block so each scanline starts 32-byte aligned.
+        pitch = (width + PixelsPerAlignment - 1) / PixelsPerAlignment * PixelsPerAlignment;
+        color.allocate(size_t(pitch) * height);
+        depth.allocate(size_t(pitch) * height);
+        coarseWidth = (width + CoarseBlockSize - 1) / CoarseBlockSize;
+        coarseHeight = (height + CoarseBlockSize - 1) / CoarseBlockSize;
+        coarseDepth.allocate(size_t(coarseWidth) * coarseHeight);
+        clearDepth();
+    }
+
+    // Whole-buffer clears touch far more than the cache holds, so they always stream.
+    void clear(uint32_t value) {
+        StreamSpan(color.get(), color.size(), value);
+        StreamFence();
+    }
+
+    void fill(const ScreenRect& rect, uint32_t value, Store store = Store::Cached) {
+        for (int y = rect.top; y < rect.bottom; ++y) {
+            if (store == Store::Streaming) {
+                StreamSpan(getRow(y) + rect.left, size_t(rect.getWidth()), value);
+            } else {
+                FillSpan(getRow(y) + rect.left, size_t(rect.getWidth()), value);
+            }
+        }
+        if (store == Store::Streaming) StreamFence();
+    }
+
+    void clearDepth(float value = FarDepth) {
+        StreamSpan(depth.get(), depth.size(), value);
+        StreamFence();
+        FillSpan(coarseDepth.get(), coarseDepth.size(), value);
+    }
+
+    void fillDepth(const ScreenRect& rect, float value = FarDepth, Store store = Store::Cached) {
+        for (int y = rect.top; y < rect.bottom; ++y) {
+            if (store == Store::Streaming) {
+                StreamSpan(getDepthRow(y) + rect.left, size_t(rect.getWidth()), value);
+            } else {
+                FillSpan(getDepthRow(y) + rect.left, size_t(rect.getWidth()), value);
+            }
+        }
+        if (store == Store::Streaming) StreamFence();
+        // Blocks only partly inside rect keep other depths too, so they may only grow.
+        ScreenRect blocks = getCoarseBlocks(rect);
+        for (int by = blocks.top; by < blocks.bottom; ++by) {
+            for (int bx = blocks.left; bx < blocks.right; ++bx) {
+                float& bound = coarseDepth[size_t(by) * coarseWidth + bx];
+                bound = std::max(bound, value);
+            }
+        }
+    }
+
+    // Recomputes the bound of one block from its depths. Only valid for blocks
+    // that lie entirely inside the framebuffer, since it reads all of them.
+    void updateCoarseDepth(int blockX, int blockY) {
+        const float* row = getDepthRow(blockY * CoarseBlockSize) + blockX * CoarseBlockSize;
+#if defined(ENGINE_FILL_SSE2)
+        __m128 bound = _mm_load_ps(row);
+        for (int y = 0; y < CoarseBlockSize; ++y, row += pitch) {
+            bound = _mm_max_ps(bound, _mm_max_ps(_mm_load_ps(row), _mm_load_ps(row + 4)));
+        }
+        bound = _mm_max_ps(bound, _mm_shuffle_ps(bound, bound, _MM_SHUFFLE(1, 0, 3, 2)));
+        bound = _mm_max_ps(bound, _mm_shuffle_ps(bound, bound, _MM_SHUFFLE(2, 3, 0, 1)));
+        coarseDepth[size_t(blockY) * coarseWidth + blockX] = _mm_cvtss_f32(bound);
+#elif defined(ENGINE_FILL_NEON)
+        float32x4_t bound = vld1q_f32(row);
+        for (int y = 0; y < CoarseBlockSize; ++y, row += pitch) {
+            bound = vmaxq_f32(bound, vmaxq_f32(vld1q_f32(row), vld1q_f32(row + 4)));
+        }
+        coarseDepth[size_t(blockY) * coarseWidth + blockX] = vmaxvq_f32(bound);
+#else
+        float bound = row[0];
+        for (int y = 0; y < CoarseBlockSize; ++y, row += pitch) {
+            for (int x = 0; x < CoarseBlockSize; ++x) bound = std::max(bound, row[x]);
+        }
+        coarseDepth[size_t(blockY) * coarseWidth + blockX] = bound;
+#endif
+    }
+
+    float getCoarseDepth(int blockX, int blockY) const { return coarseDepth[size_t(blockY) * coarseWidth + blockX]; }
+
+    // True when nothing at nearestDepth or farther can pass the depth test
+    // anywhere in rect. A rect entirely off screen is trivially occluded.
+    bool isOccluded(const ScreenRect& rect, float nearestDepth) const {
+        ScreenRect blocks = getCoarseBlocks(rect);
+        for (int by = blocks.top; by < blocks.bottom; ++by) {
+            const float* bounds = coarseDepth.get() + size_t(by) * coarseWidth;
+            for (int bx = blocks.left; bx < blocks.right; ++bx) {
+                if (!(nearestDepth >= bounds[bx])) return false;
+            }
+        }
+        return true;
+    }
+
+    void setPixel(int x, int y, uint32_t value) {
+        if ((unsigned)x < (unsigned)width && (unsigned)y < (unsigned)height) {
+            color[size_t(y) * pitch + x] = value;
+        }
+    }
+
+    uint32_t getPixel(int x, int y) const {
+        return color[size_t(y) * pitch + x];
+    }
+
+    uint32_t* getRow(int y) { return color.get() + size_t(y) * pitch; }
+    const uint32_t* getRow(int y) const { return color.get() + size_t(y) * pitch; }
+
+    float getDepth(int x, int y) const { return depth[size_t(y) * pitch + x]; }
+    float* getDepthRow(int y) { return depth.get() + size_t(y) * pitch; }
+    const float* getDepthRow(int y) const { return depth.get() + size_t(y) * pitch; }
+
+    uint32_t* getPixels() { return color.get(); }
+    const uint32_t* getPixels() const { return color.get(); }
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    ScreenRect getBounds() const { return ScreenRect{ 0, 0, width, height }; }
+    // Row stride in pixels; always a multiple of PixelsPerAlignment.
+    int getPitch() const { return pitch; }
+
+private:
+    int width = 0;
+    int height = 0;
+    int pitch = 0;
+    AlignedBuffer<uint32_t, Alignment> color;
+    AlignedBuffer<float, Alignment> depth;
+    AlignedBuffer<float, Alignment> coarseDepth;
+    int coarseWidth = 0;
+    int coarseHeight = 0;
+
+    // Block range overlapped by rect after clipping it to the framebuffer.
+    ScreenRect getCoarseBlocks(const ScreenRect& rect) const {
+        int left = std::max(rect.left, 0), top = std::max(rect.top, 0);
+        int right = std::min(rect.right, width), bottom = std::min(rect.bottom, height);
+        if (left >= right || top >= bottom) return ScreenRect{ 0, 0, 0, 0 };
+        return ScreenRect{ left / CoarseBlockSize, top / CoarseBlockSize,
+            (right + CoarseBlockSize - 1) / CoarseBlockSize, (bottom + CoarseBlockSize - 1) / CoarseBlockSize };
+    }
+};
@@ -0,0 +1,246 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <vector>
+#include <cmath>
+#include "MathTypes.h"
+#include "VertexStreams.h"
+
+struct triangle {
+    vec3d p1, p2, p3;
+    triangle() = default;
+    triangle(vec3d p1, vec3d p2, vec3d p3) : p1(p1), p2(p2), p3(p3) {}
+};
+
+// Undirected mesh edge between vertices a < b, with the one or two triangles
+// that share it; triangle1 is NoTriangle on an open boundary.
+struct MeshEdge {
+    static constexpr uint32_t NoTriangle = 0xFFFFFFFFu;
+    uint32_t a, b;
+    uint32_t triangle0, triangle1;
+};
+
+// Indexed triangle list: every unique vertex is stored once, as SoA streams,
+// and triangles refer to it by index. Indices are kept 16-bit whenever the
+// vertex count allows it. The unique edges are listed once as well, so
+// wireframe drawing visits each shared edge a single time.
+class Mesh {
+public:
+    VertexStreams vertices;
+
+    vec3d getVertex(size_t i) const {
+        return vec3d(vertices.x[i], vertices.y[i], vertices.z[i]);
+    }
+
+    void setVertex(size_t i, const vec3d& v) {
+        vertices.x[i] = v.x;
+        vertices.y[i] = v.y;
+        vertices.z[i] = v.z;
+    }
+
+    // Call after vertices are filled; the vertex count decides the index width.
+    void setIndices(const std::vector<uint32_t>& indices) {
+        indexCount = indices.size();
+        shortIndices = vertices.size() <= 0x10000;
+        indices16.clear();
+        indices32.clear();
+        if (shortIndices) {
+            indices16.assign(indices.begin(), indices.end());
+        }
+        else {
+            indices32 = indices;
+        }
+        buildEdges();
+    }
+
+    const std::vector<MeshEdge>& getEdges() const { return edges; }
+
+    size_t getTriangleCount() const { return indexCount / 3; }
+    bool hasShortIndices() const { return shortIndices; }
+
+    void getTriangle(size_t tri, uint32_t& a, uint32_t& b, uint32_t& c) const {
+        size_t i = tri * 3;
+        if (shortIndices) {
+            a = indices16[i]; b = indices16[i + 1]; c = indices16[i + 2];
+        }
+        else {
+            a = indices32[i]; b = indices32[i + 1]; c = indices32[i + 2];
+        }
+    }
+
+    // Bounding sphere of the rest pose; call after the vertices are final.
+    void updateBounds() {
+        size_t count = vertices.size();
+        vec3d low = count ? getVertex(0) : vec3d(0, 0, 0), high = low;
+        for (size_t i = 1; i < count; ++i) {
+            vec3d v = getVertex(i);
+            low = vec3d(std::min(low.x, v.x), std::min(low.y, v.y), std::min(low.z, v.z));
+            high = vec3d(std::max(high.x, v.x), std::max(high.y, v.y), std::max(high.z, v.z));
+        }
+        bounds.center = (low + high) * 0.5f;
+        bounds.radius = 0;
+        for (size_t i = 0; i < count; ++i) {
+            bounds.radius = std::max(bounds.radius, (getVertex(i) - bounds.center).length());
+        }
+    }
+
+    const BoundingSphere& getBounds() const { return bounds; }
+
+    size_t getMemoryUsage() const {
+        return vertices.getPaddedSize() * 3 * sizeof(float) + indices16.size() * sizeof(uint16_t) + indices32.size() * sizeof(uint32_t)
+            + edges.size() * sizeof(MeshEdge);
+    }
+
+private:
+    // Sorts every triangle side by its vertex pair and merges equal pairs.
+    // Edges shared by more than two triangles keep the first two.
+    void buildEdges() {
+        struct Side { uint32_t a, b, triangle; };
+        std::vector<Side> sides;
+        sides.reserve(indexCount);
+        for (size_t t = 0; t < getTriangleCount(); ++t) {
+            uint32_t v[3];
+            getTriangle(t, v[0], v[1], v[2]);
+            for (int i = 0; i < 3; ++i) {
+                uint32_t a = v[i], b = v[(i + 1) % 3];
+                if (a == b) continue;
+                sides.push_back(Side{ std::min(a, b), std::max(a, b), (uint32_t)t });
+            }
+        }
+        std::sort(sides.begin(), sides.end(), [](const Side& l, const Side& r) {
+            return l.a != r.a ? l.a < r.a : l.b != r.b ? l.b < r.b : l.triangle < r.triangle;
+        });
+
+        edges.clear();
+        for (size_t i = 0; i < sides.size();) {
+            MeshEdge edge = { sides[i].a, sides[i].b, sides[i].triangle, MeshEdge::NoTriangle };
+            size_t j = i + 1;
+            if (j < sides.size() && sides[j].a == edge.a && sides[j].b == edge.b) {
+                edge.triangle1 = sides[j].triangle;
+            }
+            while (j < sides.size() && sides[j].a == edge.a && sides[j].b == edge.b) ++j;
+            edges.push_back(edge);
+            i = j;
+        }
+    }
+
+    std::vector<uint16_t> indices16;
+    std::vector<uint32_t> indices32;
+    std::vector<MeshEdge> edges;
+    size_t indexCount = 0;
+    bool shortIndices = true;
+    BoundingSphere bounds;
+};
+
+// Which screen-space winding the triangle setup discards. Front faces are the
+// ones that appear counter-clockwise on screen (y down).
+enum class CullMode {
+    None,
+    Back,
+    Front,
+};
+
+// An object's mesh is its immutable rest pose. Orientation is a quaternion with a
+// cached composite matrix that the renderer folds into each frame's MVP, so
+// vertices are only ever transformed from the rest pose and nothing drifts.
+class Object {
+public:
+    virtual void generateVertices() = 0;
+    virtual void generateIndices() = 0;
+    virtual const Mesh& getMesh() const = 0;
+    virtual ~Object() = default;
+
+    // Sets the absolute orientation: rotation about X, then Y, then Z.
+    void rotate(float angleX, float angleY, float angleZ) {
+        setOrientation(quat::fromEuler(angleX, angleY, angleZ));
+    }
+
+    void setOrientation(const quat& q) {
+        if (q == orientation) return;
+        orientation = q;
+        transform = mat4::fromQuat(q);
+        boundsDirty = true;
+    }
+
+    // The mesh's bounding sphere under the current transform, cached until it changes.
+    const BoundingSphere& getWorldBounds() const {
+        if (boundsDirty) {
+            const BoundingSphere& rest = getMesh().getBounds();
+            worldBounds.center = transform.transformPoint(rest.center).xyz();
+            worldBounds.radius = rest.radius;
+            boundsDirty = false;
+        }
+        return worldBounds;
+    }
+
+    void setCullMode(CullMode mode) { cullMode = mode; }
+    CullMode getCullMode() const { return cullMode; }
+
+    const quat& getOrientation() const { return orientation; }
+    const mat4& getTransform() const { return transform; }
+
+private:
+    quat orientation;
+    mat4 transform = mat4::identity();
+    CullMode cullMode = CullMode::Back;
+    mutable bool boundsDirty = true;
+    mutable BoundingSphere worldBounds;
+};
+
+class Sphere : public Object {
+public:
+    Sphere(float radius, int latitudeSteps, int longitudeSteps)
+        : radius(radius), latitudeSteps(latitudeSteps), longitudeSteps(longitudeSteps) {
+        generateVertices();
+        generateIndices();
+    }
+
+    void generateVertices() override {
+        mesh.vertices.resize(size_t(latitudeSteps + 1) * (longitudeSteps + 1));
+        size_t index = 0;
+        for (int lat = 0; lat <= latitudeSteps; ++lat) {
+            float theta = M_PI * lat / latitudeSteps;
+            float sinTheta = sin(theta);
+            float cosTheta = cos(theta);
+
+            for (int lon = 0; lon <= longitudeSteps; ++lon) {
+                float phi = 2 * M_PI * lon / longitudeSteps;
+                float sinPhi = sin(phi);
+                float cosPhi = cos(phi);
+
+                float x = radius * sinTheta * cosPhi;
+                float y = radius * cosTheta;
+                float z = radius * sinTheta * sinPhi;
+
+                mesh.setVertex(index++, vec3d(x, y, z));
+            }
+        }
+        mesh.updateBounds();
+    }
+
+    void generateIndices() override {
+        std::vector<uint32_t> indices;
+        indices.reserve(size_t(latitudeSteps) * longitudeSteps * 6);
+        for (int lat = 0; lat < latitudeSteps; ++lat) {
+            for (int lon = 0; lon < longitudeSteps; ++lon) {
+                uint32_t first = lat * (longitudeSteps + 1) + lon;
+                uint32_t second = first + longitudeSteps + 1;
+
+                indices.insert(indices.end(), { first, second, first + 1 });
+                indices.insert(indices.end(), { second, second + 1, first + 1 });
+            }
+        }
+        mesh.setIndices(indices);
+    }
+
+    const Mesh& getMesh() const override {
+        return mesh;
+    }
+
+private:
+    float radius;
+    int latitudeSteps;
+    int longitudeSteps;
+    Mesh mesh;
+};
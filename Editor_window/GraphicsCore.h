@@ -1,133 +1,88 @@
 #pragma once
 #include <windows.h>
-#include <vector>
-#include <cmath>
 #include <iostream>
-#include <thread>
-#ifndef M_PI
-#define M_PI 3.14159265358979323846
-#endif
-
-struct vec3d {
-    float x, y, z;
-    vec3d(float x, float y, float z) : x(x), y(y), z(z) {}
-
-    vec3d projectTo2D(int centerX, int centerY, float scale, float moveX, float moveY) const {
-        const float fov = 70.0f;
-        const float aspectRatio = 16.0f / 9.0f;
-
-        float projectedX = x / (1 + z / (fov * scale));
-        float projectedY = y / (1 + z / (fov * scale));
-
-        projectedX *= aspectRatio;
-        projectedY *= aspectRatio;
-
-        return vec3d(centerX + projectedX + moveX, centerY - projectedY + moveY, z);
-    }
-};
-
-struct triangle {
-    vec3d p1, p2, p3;
-    triangle(vec3d p1, vec3d p2, vec3d p3) : p1(p1), p2(p2), p3(p3) {}
-};
-
-class Object {
-public:
-    virtual void generateVertices() = 0;
-    virtual void generateIndices() = 0;
-    virtual const std::vector<triangle>& getTriangles() const = 0;
-    virtual void rotate(float angleX, float angleY, float angleZ) = 0;
-    virtual ~Object() = default;
-};
-
-class Sphere : public Object {
+#include <string>
+#include <vector>
+#include "FrameLoop.h"
+#include "FramePipeline.h"
+#include "Profiler.h"
+#include "Renderer.h"
+
+// Win32 presentation backend: blits the framebuffer, or just its changed
+// rectangles, straight from engine memory to a window DC.
+class Win32Presenter : public Presenter {
 public:
-    Sphere(float radius, int latitudeSteps, int longitudeSteps)
-        : radius(radius), latitudeSteps(latitudeSteps), longitudeSteps(longitudeSteps) {
-        generateVertices();
-        generateIndices();
+    void setTarget(HDC hdc) {
+        target = hdc;
     }
 
-    void generateVertices() override {
-        vertices.clear();
-        for (int lat = 0; lat <= latitudeSteps; ++lat) {
-            float theta = M_PI * lat / latitudeSteps;
-            float sinTheta = sin(theta);
-            float cosTheta = cos(theta);
-
-            for (int lon = 0; lon <= longitudeSteps; ++lon) {
-                float phi = 2 * M_PI * lon / longitudeSteps;
-                float sinPhi = sin(phi);
-                float cosPhi = cos(phi);
-
-                float x = radius * sinTheta * cosPhi;
-                float y = radius * cosTheta;
-                float z = radius * sinTheta * sinPhi;
-
-                vertices.push_back(vec3d(x, y, z));
-            }
-        }
-    }
-
-    void generateIndices() override {
-        triangles.clear();
-        for (int lat = 0; lat < latitudeSteps; ++lat) {
-            for (int lon = 0; lon < longitudeSteps; ++lon) {
-                int first = lat * (longitudeSteps + 1) + lon;
-                int second = first + longitudeSteps + 1;
-
-                triangles.push_back(triangle(vertices[first], vertices[second], vertices[first + 1]));
-                triangles.push_back(triangle(vertices[second], vertices[second + 1], vertices[first + 1]));
-            }
-        }
+    void present(const Framebuffer& framebuffer) override {
+        blit(framebuffer, framebuffer.getBounds());
     }
 
-    void rotate(float angleX, float angleY, float angleZ) override {
-        float cosX = cos(angleX), sinX = sin(angleX);
-        float cosY = cos(angleY), sinY = sin(angleY);
-        float cosZ = cos(angleZ), sinZ = sin(angleZ);
-
-        for (auto& vertex : vertices) {
-            float y = vertex.y * cosX - vertex.z * sinX;
-            float z = vertex.y * sinX + vertex.z * cosX;
-            vertex.y = y; vertex.z = z;
-
-            float x = vertex.x * cosY + vertex.z * sinY;
-            z = -vertex.x * sinY + vertex.z * cosY;
-            vertex.x = x; vertex.z = z;
-
-            x = vertex.x * cosZ - vertex.y * sinZ;
-            y = vertex.x * sinZ + vertex.y * cosZ;
-            vertex.x = x; vertex.y = y;
+    void presentRegions(const Framebuffer& framebuffer, const std::vector<ScreenRect>& regions) override {
+        for (const ScreenRect& region : regions) {
+            blit(framebuffer, region);
         }
-        generateIndices();
-    }
-
-    const std::vector<triangle>& getTriangles() const override {
-        return triangles;
     }
 
 private:
-    float radius;
-    int latitudeSteps;
-    int longitudeSteps;
-    std::vector<vec3d> vertices;
-    std::vector<triangle> triangles;
+    HDC target = NULL;
+
+    // Copies one rectangle, described to GDI as a top-down DIB that starts at
+    // the rectangle's first row.
+    void blit(const Framebuffer& framebuffer, const ScreenRect& region) {
+        int left = std::max(region.left, 0), top = std::max(region.top, 0);
+        int right = std::min(region.right, framebuffer.getWidth()), bottom = std::min(region.bottom, framebuffer.getHeight());
+        if (left >= right || top >= bottom) return;
+        ENGINE_PROFILE_SCOPE("blit");
+
+        BITMAPINFO bmi = { 0 };
+        bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+        bmi.bmiHeader.biWidth = framebuffer.getPitch();
+        bmi.bmiHeader.biHeight = -(bottom - top);
+        bmi.bmiHeader.biPlanes = 1;
+        bmi.bmiHeader.biBitCount = 32;
+        bmi.bmiHeader.biCompression = BI_RGB;
+
+        SetDIBitsToDevice(target, left, top, right - left, bottom - top,
+            left, 0, 0, bottom - top, framebuffer.getRow(top), &bmi, DIB_RGB_COLORS);
+    }
 };
 
 class RenderingEngine {
 public:
-    RenderingEngine(int width, int height)
-        : WIDTH(width), HEIGHT(height), centerX(width / 2), centerY(height / 2), angleX(0), angleY(0), angleZ(0), moveX(0), moveY(0), degree(0), r(400) {}
+    // An editor window has no use for frames the display cannot show.
+    static constexpr double DefaultFrameRateLimit = 60.0;
 
-    ~RenderingEngine() {
-        DeleteObject(SelectObject(hdcMem, hOldBitmap));
-        DeleteObject(hBitmap);
-        DeleteDC(hdcMem);
+    RenderingEngine(int width, int height, unsigned workerCount = ThreadPool::AutoWorkerCount, bool pinThreads = false)
+        : WIDTH(width), HEIGHT(height), renderer(width, height, workerCount, pinThreads), loop(Renderer::SimulationStep) {
+        loop.setFrameRateLimit(DefaultFrameRateLimit);
     }
 
     void addObject(Object* obj) {
-        objects.push_back(obj);
+        renderer.addObject(obj);
+    }
+
+    // Caps how often Run() renders, DefaultFrameRateLimit unless changed; 0
+    // renders whenever the message queue is empty. The simulation rate is
+    // fixed either way.
+    void setFrameRateLimit(double framesPerSecond) {
+        loop.setFrameRateLimit(framesPerSecond);
+    }
+
+    // Frames in flight (see FramePipeline): 1 simulates and draws each frame
+    // in turn on the window thread; the default 2 simulates the next frame on
+    // its own thread while the window thread draws and presents this one.
+    void setPipelineDepth(int depth) {
+        pipelineDepth = depth;
+    }
+
+    // Profiles every frame stage while Run() is going; when it returns, the
+    // trace is written to tracePath and frame-time percentiles are printed.
+    void enableProfiling(const std::string& tracePath) {
+        this->tracePath = tracePath;
+        Profiler::setEnabled(true);
     }
 
     void Run() {
@@ -151,13 +106,38 @@ public:
             return;
         }
 
+        // The first paint shows the framebuffer before the loop has drawn it.
+        renderer.render();
         ShowWindow(hwnd, SW_SHOWNORMAL);
         UpdateWindow(hwnd);
 
-        MSG msg;
-        while (GetMessage(&msg, NULL, 0, 0)) {
-            TranslateMessage(&msg);
-            DispatchMessage(&msg);
+        // Drain the queue, then draw and present the next simulated frame.
+        // From here on only simulateFrame() touches the scene.
+        Profiler::setThreadName("window");
+        loop.reset();
+        {
+            FramePipeline pipeline(renderer, [this](FrameSnapshot& snapshot) { simulateFrame(snapshot); }, pipelineDepth);
+            MSG msg;
+            bool quit = false;
+            while (!quit) {
+                while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
+                    if (msg.message == WM_QUIT) {
+                        quit = true;
+                        break;
+                    }
+                    TranslateMessage(&msg);
+                    DispatchMessage(&msg);
+                }
+                if (!quit) pipeline.renderFrame([hwnd](Renderer& drawn) { presentFrame(hwnd, drawn); });
+            }
+        }
+
+        // The pipeline's thread has stopped, so no scope is still recording.
+        if (!tracePath.empty()) {
+            if (!Profiler::writeChromeTrace(tracePath)) {
+                std::cerr << "Failed to write trace to " << tracePath << "." << std::endl;
+            }
+            Profiler::printSummary(std::cout);
         }
     }
 
@@ -184,96 +164,67 @@ public:
 private:
     const int WIDTH;
     const int HEIGHT;
-    int centerX;
-    int centerY;
-    float angleX, angleY, angleZ;
-    float moveX, moveY;
-    float degree;
-    int r;
-    HDC hdcMem = NULL;
-    HBITMAP hBitmap = NULL;
-    HBITMAP hOldBitmap = NULL;
-    std::vector<Object*> objects;
-    void DrawPixel(HDC hdc, int x, int y, COLORREF color) {
-        SetPixel(hdc, x, y, color);
+    Renderer renderer;
+    Win32Presenter presenter;
+    FrameLoop loop;
+    int pipelineDepth = 2;
+    std::string tracePath;
+    std::vector<char> regionData;
+    std::vector<ScreenRect> paintRegions;
+
+    // The window's pending update region as rectangles: whatever render()
+    // dirtied plus anything the window system exposed.
+    void getUpdateRegions(HWND hwnd) {
+        paintRegions.clear();
+        HRGN update = CreateRectRgn(0, 0, 0, 0);
+        GetUpdateRgn(hwnd, update, FALSE);
+        DWORD size = GetRegionData(update, 0, NULL);
+        regionData.resize(size);
+        if (size && GetRegionData(update, size, reinterpret_cast<RGNDATA*>(regionData.data()))) {
+            const RGNDATA* data = reinterpret_cast<const RGNDATA*>(regionData.data());
+            const RECT* rects = reinterpret_cast<const RECT*>(data->Buffer);
+            for (DWORD i = 0; i < data->rdh.nCount; ++i) {
+                paintRegions.push_back(ScreenRect{ (int)rects[i].left, (int)rects[i].top, (int)rects[i].right, (int)rects[i].bottom });
+            }
+        }
+        DeleteObject(update);
     }
 
-    void DrawLine(HDC hdc, int x1, int y1, int x2, int y2, COLORREF color) {
-        int dx = abs(x2 - x1), sx = x1 < x2 ? 1 : -1;
-        int dy = -abs(y2 - y1), sy = y1 < y2 ? 1 : -1;
-        int err = dx + dy, e2;
-
-        while (true) {
-            DrawPixel(hdc, x1, y1, color);
-            if (x1 == x2 && y1 == y2) break;
-            e2 = 2 * err;
-            if (e2 >= dy) { err += dy; x1 += sx; }
-            if (e2 <= dx) { err += dx; y1 += sy; }
+    // Runs whatever simulation steps the elapsed time owes and captures the
+    // scene interpolated between the last two steps.
+    void simulateFrame(FrameSnapshot& snapshot) {
+        int steps = loop.beginFrame();
+        for (int i = 0; i < steps; ++i) {
+            renderer.update();
         }
+        renderer.capture(snapshot, loop.getAlpha());
     }
 
-    void DrawTriangle(HDC hdc, vec3d p1, vec3d p2, vec3d p3, COLORREF color) {
-        DrawLine(hdc, (int)p1.x, (int)p1.y, (int)p2.x, (int)p2.y, color);
-        DrawLine(hdc, (int)p2.x, (int)p2.y, (int)p3.x, (int)p3.y, color);
-        DrawLine(hdc, (int)p3.x, (int)p3.y, (int)p1.x, (int)p1.y, color);
+    static void presentFrame(HWND hwnd, const Renderer& drawn) {
+        // Only what changed needs repainting, and the framebuffer covers it
+        // completely, so there is no background to erase. Painting right away
+        // keeps presentation in step with the frame just drawn.
+        for (const ScreenRect& region : drawn.getDirtyRegions()) {
+            RECT rect = { region.left, region.top, region.right, region.bottom };
+            InvalidateRect(hwnd, &rect, FALSE);
+        }
+        UpdateWindow(hwnd);
     }
 
     LRESULT HandleMessage(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam) {
         switch (uMsg) {
-        case WM_CREATE: {
-            HDC hdcWindow = GetDC(hwnd);
-            hdcMem = CreateCompatibleDC(hdcWindow);
-            hBitmap = CreateCompatibleBitmap(hdcWindow, WIDTH, HEIGHT);
-            hOldBitmap = (HBITMAP)SelectObject(hdcMem, hBitmap);
-            ReleaseDC(hwnd, hdcWindow);
-            SetTimer(hwnd, 1, 16, NULL);
-            break;
-        }
-
-        case WM_TIMER: {
-            angleX += 0.01f;
-            angleY += 0.01f;
-            angleZ += 0.01f;
-
-            degree += 3;
-            if (degree > 360) degree = 0;
 
-            moveX = r * cos(degree * M_PI / 180.0f);
-            moveY = r * sin(degree * M_PI / 180.0f);
-
-            std::thread rotationThread([&]() {
-                for (auto obj : objects) {
-                    obj->rotate(angleX, angleY, angleZ);
-                }
-                });
-            rotationThread.join();
-
-            InvalidateRect(hwnd, NULL, TRUE);
-            break;
-        }
+        case WM_ERASEBKGND:
+            return 1;
 
         case WM_PAINT: {
+            getUpdateRegions(hwnd);
             PAINTSTRUCT ps;
             HDC hdcWindow = BeginPaint(hwnd, &ps);
 
-            RECT rect;
-            GetClientRect(hwnd, &rect);
-            FillRect(hdcMem, &rect, (HBRUSH)GetStockObject(WHITE_BRUSH));
-
-            for (const auto& obj : objects) {
-                const std::vector<triangle>& triangles = obj->getTriangles();
-                std::thread drawingThread([&]() {
-                    for (const auto& tri : triangles) {
-                        vec3d p1 = tri.p1.projectTo2D(centerX, centerY, 8.0f, moveX, moveY);
-                        vec3d p2 = tri.p2.projectTo2D(centerX, centerY, 8.0f, moveX, moveY);
-                        vec3d p3 = tri.p3.projectTo2D(centerX, centerY, 8.0f, moveX, moveY);
-                        DrawTriangle(hdcMem, p1, p2, p3, RGB(0, 0, 255));
-                    }
-                    });
-                drawingThread.join();
-            }
+            presenter.setTarget(hdcWindow);
+            renderer.present(presenter, paintRegions);
 
-            BitBlt(hdcWindow, 0, 0, WIDTH, HEIGHT, hdcMem, 0, 0, SRCCOPY);
             EndPaint(hwnd, &ps);
             break;
         }
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Presenter.h"
+
+inline bool WritePPM(const Framebuffer& framebuffer, const std::string& path) {
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) return false;
+
+    std::fprintf(file, "P6\n%d %d\n255\n", framebuffer.getWidth(), framebuffer.getHeight());
+    std::vector<unsigned char> row(size_t(framebuffer.getWidth()) * 3);
+    for (int y = 0; y < framebuffer.getHeight(); ++y) {
+        const uint32_t* src = framebuffer.getRow(y);
+        for (int x = 0; x < framebuffer.getWidth(); ++x) {
+            row[x * 3 + 0] = (unsigned char)(src[x] >> 16);
+            row[x * 3 + 1] = (unsigned char)(src[x] >> 8);
+            row[x * 3 + 2] = (unsigned char)(src[x]);
+        }
+        std::fwrite(row.data(), 1, row.size(), file);
+    }
+    return std::fclose(file) == 0;
+}
+
+// Offscreen backend: frames stay in the engine-owned framebuffer. When an output
+// path is given, every presented frame is written there as a binary PPM.
+class HeadlessPresenter : public Presenter {
+public:
+    explicit HeadlessPresenter(std::string outputPath = std::string())
+        : outputPath(std::move(outputPath)) {}
+
+    void present(const Framebuffer& framebuffer) override {
+        ++frameCount;
+        if (!outputPath.empty() && !WritePPM(framebuffer, outputPath)) {
+            std::cerr << "Failed to write frame to " << outputPath << "." << std::endl;
+        }
+    }
+
+    unsigned long long getFrameCount() const { return frameCount; }
+
+private:
+    std::string outputPath;
+    unsigned long long frameCount = 0;
+};
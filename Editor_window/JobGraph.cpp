@@ -0,0 +1,62 @@
+#include "JobGraph.h"
+
+JobGraph::JobId JobGraph::add(std::function<void()> work) {
+    if (jobCount == jobs.size()) {
+        jobs.emplace_back();
+    }
+    Job& job = jobs[jobCount];
+    job.work = std::move(work);
+    job.successors.clear();
+    job.dependencyCount = 0;
+    return jobCount++;
+}
+
+void JobGraph::addDependency(JobId prerequisite, JobId job) {
+    jobs[prerequisite].successors.push_back(job);
+    ++jobs[job].dependencyCount;
+}
+
+void JobGraph::clear() {
+    for (size_t i = 0; i < jobCount; ++i) {
+        jobs[i].work = nullptr;
+    }
+    jobCount = 0;
+}
+
+void JobGraph::run(ThreadPool& pool) {
+    if (jobCount == 0) return;
+
+    if (remainingCapacity < jobCount) {
+        remaining = std::make_unique<std::atomic<unsigned>[]>(jobCount);
+        remainingCapacity = jobCount;
+    }
+    for (size_t i = 0; i < jobCount; ++i) {
+        remaining[i].store(jobs[i].dependencyCount);
+    }
+    jobsLeft.store(jobCount);
+    finished.store(false);
+
+    for (size_t i = 0; i < jobCount; ++i) {
+        if (jobs[i].dependencyCount == 0) {
+            schedule(pool, i);
+        }
+    }
+
+    pool.helpUntil([this]() { return finished.load(); });
+}
+
+void JobGraph::schedule(ThreadPool& pool, JobId id) {
+    pool.submit([this, &pool, id]() {
+        jobs[id].work();
+        for (JobId successor : jobs[id].successors) {
+            if (remaining[successor].fetch_sub(1) == 1) {
+                schedule(pool, successor);
+            }
+        }
+        if (jobsLeft.fetch_sub(1) == 1) {
+            // run() may return as soon as this is set, so the graph is not touched after it.
+            finished.store(true);
+            pool.wakeHelpers();
+        }
+        });
+}
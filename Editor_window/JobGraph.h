@@ -0,0 +1,44 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "ThreadPool.h"
+
+// A set of jobs with explicit ordering constraints, executed on a ThreadPool.
+// Jobs become runnable once all of their prerequisites have finished and are
+// pushed onto the finishing worker's own deque, so dependent work tends to run
+// where its inputs are still in cache. The graph must be acyclic.
+class JobGraph {
+public:
+    using JobId = size_t;
+
+    JobId add(std::function<void()> work);
+    // `job` will not start before `prerequisite` has finished.
+    void addDependency(JobId prerequisite, JobId job);
+
+    // Runs every job and blocks until all have finished. The calling thread
+    // executes queued pool tasks while it waits and sleeps when there are none.
+    void run(ThreadPool& pool);
+
+    // Drops all jobs; storage is kept so a graph can be rebuilt every frame cheaply.
+    void clear();
+    size_t size() const { return jobCount; }
+
+private:
+    struct Job {
+        std::function<void()> work;
+        std::vector<JobId> successors;
+        unsigned dependencyCount = 0;
+    };
+
+    void schedule(ThreadPool& pool, JobId id);
+
+    std::vector<Job> jobs;
+    size_t jobCount = 0;
+    std::unique_ptr<std::atomic<unsigned>[]> remaining;
+    size_t remainingCapacity = 0;
+    std::atomic<size_t> jobsLeft{ 0 };
+    std::atomic<bool> finished{ false };
+};
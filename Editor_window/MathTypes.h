@@ -0,0 +1,218 @@
+#pragma once
+#include <cmath>
+// ENGINE_FORCE_SCALAR turns off the compile-time SIMD paths, as in Framebuffer.h.
+#if !defined(ENGINE_FORCE_SCALAR) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define ENGINE_MATH_SSE 1
+#include <xmmintrin.h>
+#elif !defined(ENGINE_FORCE_SCALAR) && (defined(__aarch64__) || defined(_M_ARM64))
+#define ENGINE_MATH_NEON 1
+#include <arm_neon.h>
+#endif
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Small vector/matrix/quaternion library. Matrices are row-major and act on
+// column vectors (v' = M * v), so a concatenation A * B applies B first. The
+// SSE/NEON matrix product is chosen at compile time; both targets have it as baseline.
+
+struct vec3d {
+    float x, y, z;
+    vec3d() : x(0), y(0), z(0) {}
+    vec3d(float x, float y, float z) : x(x), y(y), z(z) {}
+
+    vec3d operator+(const vec3d& o) const { return vec3d(x + o.x, y + o.y, z + o.z); }
+    vec3d operator-(const vec3d& o) const { return vec3d(x - o.x, y - o.y, z - o.z); }
+    vec3d operator*(float s) const { return vec3d(x * s, y * s, z * s); }
+
+    float dot(const vec3d& o) const { return x * o.x + y * o.y + z * o.z; }
+    vec3d cross(const vec3d& o) const { return vec3d(y * o.z - z * o.y, z * o.x - x * o.z, x * o.y - y * o.x); }
+    float length() const { return std::sqrt(dot(*this)); }
+    vec3d normalized() const {
+        float len = length();
+        return len > 0 ? *this * (1.0f / len) : *this;
+    }
+};
+
+struct alignas(16) vec4 {
+    float x, y, z, w;
+    vec4() : x(0), y(0), z(0), w(0) {}
+    vec4(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+    vec4(const vec3d& v, float w) : x(v.x), y(v.y), z(v.z), w(w) {}
+
+    vec3d xyz() const { return vec3d(x, y, z); }
+    // Perspective divide.
+    vec3d project() const {
+        float invW = 1.0f / w;
+        return vec3d(x * invW, y * invW, z * invW);
+    }
+};
+
+struct quat {
+    float x, y, z, w;
+    quat() : x(0), y(0), z(0), w(1) {}
+    quat(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+
+    static quat fromAxisAngle(const vec3d& axis, float angle) {
+        vec3d n = axis.normalized();
+        float s = std::sin(angle * 0.5f);
+        return quat(n.x * s, n.y * s, n.z * s, std::cos(angle * 0.5f));
+    }
+
+    // Same convention as the engine's Euler angles: about X, then Y, then Z.
+    static quat fromEuler(float angleX, float angleY, float angleZ) {
+        return fromAxisAngle(vec3d(0, 0, 1), angleZ) * fromAxisAngle(vec3d(0, 1, 0), angleY) * fromAxisAngle(vec3d(1, 0, 0), angleX);
+    }
+
+    quat operator*(const quat& o) const {
+        return quat(
+            w * o.x + x * o.w + y * o.z - z * o.y,
+            w * o.y - x * o.z + y * o.w + z * o.x,
+            w * o.z + x * o.y - y * o.x + z * o.w,
+            w * o.w - x * o.x - y * o.y - z * o.z);
+    }
+
+    bool operator==(const quat& o) const { return x == o.x && y == o.y && z == o.z && w == o.w; }
+    bool operator!=(const quat& o) const { return !(*this == o); }
+
+    // Inverse rotation for unit quaternions.
+    quat conjugate() const { return quat(-x, -y, -z, w); }
+
+    quat normalized() const {
+        float len = std::sqrt(x * x + y * y + z * z + w * w);
+        return len > 0 ? quat(x / len, y / len, z / len, w / len) : quat();
+    }
+
+    vec3d rotate(const vec3d& v) const {
+        vec3d u(x, y, z);
+        vec3d t = u.cross(v) * 2.0f;
+        return v + t * w + u.cross(t);
+    }
+};
+
+struct BoundingSphere {
+    vec3d center;
+    float radius = 0;
+};
+
+// Parameters of the engine's screen-space perspective mapping:
+//   k  = aspectRatio / (1 + z / focalLength)
+//   sx = centerX + offsetX + x * k
+//   sy = centerY + offsetY - y * k
+struct ProjectionParams {
+    float centerX, centerY;
+    float focalLength;
+    float aspectRatio;
+    float offsetX, offsetY;
+};
+
+struct alignas(16) mat4 {
+    float m[16];
+
+    static mat4 identity() {
+        return mat4{ { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 } };
+    }
+
+    static mat4 translation(float x, float y, float z) {
+        return mat4{ { 1, 0, 0, x, 0, 1, 0, y, 0, 0, 1, z, 0, 0, 0, 1 } };
+    }
+
+    static mat4 scale(float x, float y, float z) {
+        return mat4{ { x, 0, 0, 0, 0, y, 0, 0, 0, 0, z, 0, 0, 0, 0, 1 } };
+    }
+
+    static mat4 rotationX(float a) {
+        float c = std::cos(a), s = std::sin(a);
+        return mat4{ { 1, 0, 0, 0, 0, c, -s, 0, 0, s, c, 0, 0, 0, 0, 1 } };
+    }
+
+    static mat4 rotationY(float a) {
+        float c = std::cos(a), s = std::sin(a);
+        return mat4{ { c, 0, s, 0, 0, 1, 0, 0, -s, 0, c, 0, 0, 0, 0, 1 } };
+    }
+
+    static mat4 rotationZ(float a) {
+        float c = std::cos(a), s = std::sin(a);
+        return mat4{ { c, -s, 0, 0, s, c, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 } };
+    }
+
+    static mat4 fromQuat(const quat& q) {
+        float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+        float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+        float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+        return mat4{ {
+            1 - 2 * (yy + zz), 2 * (xy - wz),     2 * (xz + wy),     0,
+            2 * (xy + wz),     1 - 2 * (xx + zz), 2 * (yz - wx),     0,
+            2 * (xz - wy),     2 * (yz + wx),     1 - 2 * (xx + yy), 0,
+            0,                 0,                 0,                 1,
+        } };
+    }
+
+    // Homogeneous form of the engine's perspective mapping: transforming (x, y, z, 1)
+    // gives w = 1 + z / focalLength and, after the divide, the screen position of
+    // ProjectionParams with z / w as depth.
+    static mat4 screenProjection(const ProjectionParams& p) {
+        float invFocal = 1.0f / p.focalLength;
+        float baseX = p.centerX + p.offsetX;
+        float baseY = p.centerY + p.offsetY;
+        return mat4{ {
+            p.aspectRatio, 0,              baseX * invFocal, baseX,
+            0,             -p.aspectRatio, baseY * invFocal, baseY,
+            0,             0,              1,                0,
+            0,             0,              invFocal,         1,
+        } };
+    }
+
+    mat4 operator*(const mat4& b) const {
+        mat4 r;
+#if defined(ENGINE_MATH_SSE)
+        __m128 b0 = _mm_load_ps(b.m), b1 = _mm_load_ps(b.m + 4), b2 = _mm_load_ps(b.m + 8), b3 = _mm_load_ps(b.m + 12);
+        for (int i = 0; i < 4; ++i) {
+            const float* a = m + i * 4;
+            __m128 row = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a[0]), b0), _mm_mul_ps(_mm_set1_ps(a[1]), b1)),
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a[2]), b2), _mm_mul_ps(_mm_set1_ps(a[3]), b3)));
+            _mm_store_ps(r.m + i * 4, row);
+        }
+#elif defined(ENGINE_MATH_NEON)
+        float32x4_t b0 = vld1q_f32(b.m), b1 = vld1q_f32(b.m + 4), b2 = vld1q_f32(b.m + 8), b3 = vld1q_f32(b.m + 12);
+        for (int i = 0; i < 4; ++i) {
+            const float* a = m + i * 4;
+            float32x4_t row = vmulq_n_f32(b0, a[0]);
+            row = vfmaq_n_f32(row, b1, a[1]);
+            row = vfmaq_n_f32(row, b2, a[2]);
+            row = vfmaq_n_f32(row, b3, a[3]);
+            vst1q_f32(r.m + i * 4, row);
+        }
+#else
+        for (int i = 0; i < 4; ++i) {
+            for (int j = 0; j < 4; ++j) {
+                r.m[i * 4 + j] = m[i * 4] * b.m[j] + m[i * 4 + 1] * b.m[4 + j] + m[i * 4 + 2] * b.m[8 + j] + m[i * 4 + 3] * b.m[12 + j];
+            }
+        }
+#endif
+        return r;
+    }
+
+    // Single-vector transforms stay scalar: the compiler vectorizes loops of them
+    // across iterations, while a 4-wide dot product per call measured several times
+    // slower. Bulk vertex work goes through VertexKernels instead.
+    vec4 operator*(const vec4& v) const {
+        return vec4(
+            m[0] * v.x + m[1] * v.y + m[2] * v.z + m[3] * v.w,
+            m[4] * v.x + m[5] * v.y + m[6] * v.z + m[7] * v.w,
+            m[8] * v.x + m[9] * v.y + m[10] * v.z + m[11] * v.w,
+            m[12] * v.x + m[13] * v.y + m[14] * v.z + m[15] * v.w);
+    }
+
+    vec4 transformPoint(const vec3d& p) const {
+        return *this * vec4(p, 1.0f);
+    }
+
+    bool operator==(const mat4& o) const {
+        for (int i = 0; i < 16; ++i) {
+            if (m[i] != o.m[i]) return false;
+        }
+        return true;
+    }
+};
@@ -0,0 +1,14 @@
+#pragma once
+#include <vector>
+#include "Framebuffer.h"
+
+// Hands a finished frame to whatever displays or stores it. The rendering core
+// only ever talks to this interface; window systems live behind it.
+class Presenter {
+public:
+    virtual void present(const Framebuffer& framebuffer) = 0;
+    // Only `regions` changed since the previous frame. Backends that can update
+    // part of their target override this; by default the whole frame goes out.
+    virtual void presentRegions(const Framebuffer& framebuffer, const std::vector<ScreenRect>& /*regions*/) { present(framebuffer); }
+    virtual ~Presenter() = default;
+};
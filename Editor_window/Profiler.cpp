@@ -0,0 +1,208 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+std::atomic<bool> Profiler::enabled{ false };
+
+namespace {
+struct ProfileEvent {
+    const char* name;
+    uint64_t start, end;
+};
+
+// One thread's ring, allocated by its first event so threads that are only
+// named cost nothing. Only its owner writes events; written is published with
+// release so readers between frames see every event it counts.
+struct ThreadBuffer {
+    std::unique_ptr<ProfileEvent[]> events;
+    std::atomic<uint64_t> written{ 0 };
+    std::string name;
+    unsigned id = 0;
+    // Set when the owning thread exits; the next new thread takes the buffer over.
+    bool retired = false;
+};
+
+// A finished thread's buffer stays in the trace until a new thread reuses it,
+// so the registry grows with the most threads alive at once, not with every
+// thread ever started. Frame times are a ring of the last FramesKept.
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    unsigned nextId = 1;
+    std::vector<double> frames;
+    uint64_t framesRecorded = 0;
+};
+
+Registry& GetRegistry() {
+    static Registry registry;
+    return registry;
+}
+
+std::chrono::steady_clock::time_point GetEpoch() {
+    static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    return epoch;
+}
+
+// The calling thread's buffer, handed back to the registry when the thread exits.
+struct BufferLease {
+    ThreadBuffer* buffer = nullptr;
+
+    ~BufferLease() {
+        if (!buffer) return;
+        std::lock_guard<std::mutex> lock(GetRegistry().mutex);
+        buffer->retired = true;
+    }
+};
+
+thread_local BufferLease currentLease;
+
+ThreadBuffer& GetThreadBuffer() {
+    ThreadBuffer*& buffer = currentLease.buffer;
+    if (!buffer) {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        for (const std::unique_ptr<ThreadBuffer>& candidate : registry.buffers) {
+            if (candidate->retired) {
+                buffer = candidate.get();
+                break;
+            }
+        }
+        if (buffer) {
+            // Drops the old thread's events but keeps their storage.
+            buffer->retired = false;
+            buffer->written.store(0, std::memory_order_relaxed);
+        } else {
+            registry.buffers.push_back(std::make_unique<ThreadBuffer>());
+            buffer = registry.buffers.back().get();
+        }
+        buffer->id = registry.nextId++;
+        buffer->name = "thread " + std::to_string(buffer->id);
+    }
+    return *buffer;
+}
+
+// Nearest-rank percentile of sorted values.
+double Percentile(const std::vector<double>& sorted, double percent) {
+    if (sorted.empty()) return 0;
+    size_t rank = (size_t)std::ceil(percent / 100.0 * sorted.size());
+    return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+void PrintPercentiles(std::ostream& out, const std::string& label, std::vector<double>& seconds) {
+    std::sort(seconds.begin(), seconds.end());
+    out << std::left << std::setw(20) << label << std::right << std::setw(9) << seconds.size();
+    for (double value : { Percentile(seconds, 50), Percentile(seconds, 95), Percentile(seconds, 99), seconds.empty() ? 0.0 : seconds.back() }) {
+        out << std::setw(10) << value * 1000.0;
+    }
+    out << "\n";
+}
+
+void WriteJsonString(FILE* file, const std::string& text) {
+    std::fputc('"', file);
+    for (char c : text) {
+        if (c == '"' || c == '\\') std::fputc('\\', file);
+        if ((unsigned char)c >= 0x20) std::fputc(c, file);
+    }
+    std::fputc('"', file);
+}
+}
+
+uint64_t Profiler::now() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - GetEpoch()).count();
+}
+
+void Profiler::record(const char* name, uint64_t start, uint64_t end) {
+    ThreadBuffer& buffer = GetThreadBuffer();
+    if (!buffer.events) buffer.events.reset(new ProfileEvent[EventsPerThread]);
+    uint64_t index = buffer.written.load(std::memory_order_relaxed);
+    buffer.events[index % EventsPerThread] = ProfileEvent{ name, start, end };
+    buffer.written.store(index + 1, std::memory_order_release);
+}
+
+void Profiler::setThreadName(const char* name) {
+    ThreadBuffer& buffer = GetThreadBuffer();
+    std::lock_guard<std::mutex> lock(GetRegistry().mutex);
+    buffer.name = name;
+}
+
+void Profiler::recordFrame(double seconds) {
+    if (!isEnabled()) return;
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    if (registry.frames.size() < FramesKept) {
+        registry.frames.push_back(seconds);
+    } else {
+        registry.frames[registry.framesRecorded % FramesKept] = seconds;
+    }
+    ++registry.framesRecorded;
+}
+
+bool Profiler::writeChromeTrace(const std::string& path) {
+    FILE* file = std::fopen(path.c_str(), "w");
+    if (!file) return false;
+
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    for (const std::unique_ptr<ThreadBuffer>& buffer : registry.buffers) {
+        std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", first ? "" : ",\n", buffer->id);
+        WriteJsonString(file, buffer->name);
+        std::fprintf(file, "}}");
+        first = false;
+
+        uint64_t written = buffer->written.load(std::memory_order_acquire);
+        for (uint64_t i = written > EventsPerThread ? written - EventsPerThread : 0; i < written; ++i) {
+            const ProfileEvent& event = buffer->events[i % EventsPerThread];
+            // Complete events, in microseconds.
+            std::fprintf(file, ",\n{\"name\":");
+            WriteJsonString(file, event.name);
+            std::fprintf(file, ",\"cat\":\"engine\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                buffer->id, event.start / 1000.0, (event.end - event.start) / 1000.0);
+        }
+    }
+    std::fprintf(file, "\n]}\n");
+    return std::fclose(file) == 0;
+}
+
+void Profiler::printSummary(std::ostream& out) {
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    std::vector<double> frames = registry.frames;
+    // Keyed by text rather than pointer, since equal literals need not share storage.
+    std::map<std::string, std::vector<double>> stages;
+    for (const std::unique_ptr<ThreadBuffer>& buffer : registry.buffers) {
+        uint64_t written = buffer->written.load(std::memory_order_acquire);
+        for (uint64_t i = written > EventsPerThread ? written - EventsPerThread : 0; i < written; ++i) {
+            const ProfileEvent& event = buffer->events[i % EventsPerThread];
+            stages[event.name].push_back((event.end - event.start) * 1e-9);
+        }
+    }
+
+    std::ios_base::fmtflags flags = out.flags();
+    out << std::fixed << std::setprecision(3)
+        << "stage                   count   p50 ms    p95 ms    p99 ms    max ms\n";
+    PrintPercentiles(out, "frame", frames);
+    for (auto& stage : stages) {
+        PrintPercentiles(out, stage.first, stage.second);
+    }
+    out.flags(flags);
+}
+
+void Profiler::reset() {
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (const std::unique_ptr<ThreadBuffer>& buffer : registry.buffers) {
+        buffer->written.store(0, std::memory_order_relaxed);
+    }
+    registry.frames.clear();
+    registry.framesRecorded = 0;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+// Frame-stage profiler. ENGINE_PROFILE_SCOPE("name") times the rest of the
+// enclosing block into a fixed-size ring buffer owned by the calling thread,
+// so recording takes no lock and the oldest events are overwritten once a
+// buffer fills. While profiling is off a scope costs one relaxed load; with
+// ENGINE_PROFILING=0 scopes compile to nothing.
+//
+// Frame times are kept separately, the last FramesKept of them, for the
+// percentiles that printSummary() reports. A thread's buffer outlives it and
+// is handed to the next thread that starts recording, so short-lived threads
+// do not pile up buffers. Names must be string literals (or otherwise outlive
+// the profiler), since only the pointer is stored.
+//
+// writeChromeTrace(), printSummary() and reset() read every thread's buffer:
+// call them between frames, while no scope is open.
+#ifndef ENGINE_PROFILING
+#define ENGINE_PROFILING 1
+#endif
+
+class Profiler {
+public:
+    // Events each thread keeps before it starts overwriting its oldest ones.
+    static constexpr size_t EventsPerThread = 1 << 16;
+    // Frame times kept for the summary; older ones are overwritten.
+    static constexpr size_t FramesKept = 1 << 16;
+
+    static void setEnabled(bool enable) { enabled.store(enable, std::memory_order_relaxed); }
+    static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+    // Nanoseconds since the profiler's epoch.
+    static uint64_t now();
+    static void record(const char* name, uint64_t start, uint64_t end);
+    // Labels the calling thread's track in the trace.
+    static void setThreadName(const char* name);
+    // Wall time of one whole frame; ignored while profiling is off.
+    static void recordFrame(double seconds);
+
+    // Every buffered event as Chrome trace-event JSON, for about:tracing or Perfetto.
+    static bool writeChromeTrace(const std::string& path);
+    // Frame-time percentiles, then per-stage percentiles over the buffered events.
+    static void printSummary(std::ostream& out);
+    static void reset();
+
+private:
+    static std::atomic<bool> enabled;
+};
+
+class ProfileScope {
+public:
+    explicit ProfileScope(const char* name)
+        : name(name), active(Profiler::isEnabled()), start(active ? Profiler::now() : 0) {}
+    ~ProfileScope() {
+        if (active) Profiler::record(name, start, Profiler::now());
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    const char* name;
+    bool active;
+    uint64_t start;
+};
+
+#if ENGINE_PROFILING
+#define ENGINE_PROFILE_CONCAT_(a, b) a##b
+#define ENGINE_PROFILE_CONCAT(a, b) ENGINE_PROFILE_CONCAT_(a, b)
+#define ENGINE_PROFILE_SCOPE(name) ProfileScope ENGINE_PROFILE_CONCAT(profileScope, __LINE__)(name)
+#else
+#define ENGINE_PROFILE_SCOPE(name) ((void)0)
+#endif
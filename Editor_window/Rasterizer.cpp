@@ -0,0 +1,761 @@
+#include "Rasterizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+void DrawPixel(Framebuffer& framebuffer, int x, int y, uint32_t color) {
+    framebuffer.setPixel(x, y, color);
+}
+
+void DrawLine(Framebuffer& framebuffer, int x1, int y1, int x2, int y2, uint32_t color) {
+    DrawLine(framebuffer, x1, y1, x2, y2, color, framebuffer.getBounds());
+}
+
+// Smallest integer >= a / b for b > 0.
+static int64_t CeilDiv(int64_t a, int64_t b) {
+    return a >= 0 ? (a + b - 1) / b : -((-a) / b);
+}
+
+// Lines step one pixel at a time along their major axis. At step k of `steps`
+// the minor offset is round(k * minorLength / steps), computed exactly in
+// integers, so any step can be evaluated on its own: the clip rect is turned
+// into a range of steps up front (Liang-Barsky in step space), and a line cut
+// by several tile rects produces the same pixels as the whole line would.
+// Pixels that share a row are written as one horizontal span.
+void DrawLine(Framebuffer& framebuffer, int x1, int y1, int x2, int y2, uint32_t color, const ScreenRect& clip) {
+    if (clip.left >= clip.right || clip.top >= clip.bottom) return;
+
+    int64_t dx = int64_t(x2) - x1, dy = int64_t(y2) - y1;
+    bool xMajor = std::llabs(dx) >= std::llabs(dy);
+    int64_t major0 = xMajor ? x1 : y1, minor0 = xMajor ? y1 : x1;
+    int64_t majorDelta = xMajor ? dx : dy, minorDelta = xMajor ? dy : dx;
+    int64_t majorDir = majorDelta < 0 ? -1 : 1, minorDir = minorDelta < 0 ? -1 : 1;
+    int64_t steps = std::llabs(majorDelta), minorLength = std::llabs(minorDelta);
+    int64_t first = 0, last = steps;
+    // Most lines lie inside their tile and need no clipping arithmetic.
+    if (!clip.contains(x1, y1) || !clip.contains(x2, y2)) {
+        int64_t majorLow = xMajor ? clip.left : clip.top, majorHigh = (xMajor ? clip.right : clip.bottom) - 1;
+        int64_t minorLow = xMajor ? clip.top : clip.left, minorHigh = (xMajor ? clip.bottom : clip.right) - 1;
+
+        // Steps whose major coordinate is inside the clip.
+        first = std::max<int64_t>(majorDir > 0 ? majorLow - major0 : major0 - majorHigh, 0);
+        last = std::min(majorDir > 0 ? majorHigh - major0 : major0 - majorLow, steps);
+
+        // Minor offsets inside the clip, then the steps that produce them.
+        int64_t offsetLow = minorDir > 0 ? minorLow - minor0 : minor0 - minorHigh;
+        int64_t offsetHigh = minorDir > 0 ? minorHigh - minor0 : minor0 - minorLow;
+        if (minorLength == 0) {
+            if (offsetLow > 0 || offsetHigh < 0) return;
+        } else {
+            // offset(k) = floor((2 * k * minorLength + steps) / (2 * steps))
+            first = std::max(first, CeilDiv(2 * steps * offsetLow - steps, 2 * minorLength));
+            last = std::min(last, CeilDiv(2 * steps * (offsetHigh + 1) - steps, 2 * minorLength) - 1);
+        }
+        if (first > last) return;
+    }
+
+    int64_t denominator = 2 * std::max<int64_t>(steps, 1);
+    int64_t numerator = 2 * first * minorLength + steps;
+    int64_t offset = numerator / denominator;
+    int64_t remainder = numerator % denominator;
+    int pitch = framebuffer.getPitch();
+
+    if (xMajor) {
+        int64_t k = first;
+        while (k <= last) {
+            // Extend the run while the row stays the same.
+            int64_t runStart = k;
+            int64_t runOffset = offset;
+            do {
+                ++k;
+                remainder += 2 * minorLength;
+                if (remainder >= denominator) {
+                    remainder -= denominator;
+                    ++offset;
+                }
+            } while (k <= last && offset == runOffset);
+
+            int64_t xa = major0 + majorDir * runStart, xb = major0 + majorDir * (k - 1);
+            int y = int(minor0 + minorDir * runOffset);
+            FillSpan(framebuffer.getRow(y) + std::min(xa, xb), size_t(k - runStart), color);
+        }
+    } else {
+        uint32_t* pixel = framebuffer.getRow(int(major0 + majorDir * first)) + (minor0 + minorDir * offset);
+        ptrdiff_t rowStep = ptrdiff_t(majorDir) * pitch;
+        for (int64_t k = first; k <= last; ++k) {
+            *pixel = color;
+            pixel += rowStep;
+            remainder += 2 * minorLength;
+            if (remainder >= denominator) {
+                remainder -= denominator;
+                pixel += minorDir;
+            }
+        }
+    }
+}
+
+void DrawTriangle(Framebuffer& framebuffer, const vec3d& p1, const vec3d& p2, const vec3d& p3, uint32_t color) {
+    DrawTriangle(framebuffer, p1, p2, p3, color, framebuffer.getBounds());
+}
+
+void DrawTriangle(Framebuffer& framebuffer, const vec3d& p1, const vec3d& p2, const vec3d& p3, uint32_t color, const ScreenRect& clip) {
+    DrawLine(framebuffer, (int)p1.x, (int)p1.y, (int)p2.x, (int)p2.y, color, clip);
+    DrawLine(framebuffer, (int)p2.x, (int)p2.y, (int)p3.x, (int)p3.y, color, clip);
+    DrawLine(framebuffer, (int)p3.x, (int)p3.y, (int)p1.x, (int)p1.y, color, clip);
+}
+
+// ---------------------------------------------------------------------------
+// Anti-aliased lines (Xiaolin Wu). The line steps one pixel at a time along its
+// major axis and splits each step's coverage between the two pixels straddling
+// the exact minor intercept; the end steps are weighted by how much of them
+// the line spans. Every step is evaluated from the endpoints alone, so clipping
+// only narrows the step range and tile-split lines match unsplit ones.
+// Coverages go into a small batch that is blended four pixels at a time.
+
+// Blend weights are 0..256 so a full-coverage pixel becomes exactly `color`.
+static const int CoverageOne = 256;
+static const int BlendBatchSize = 8;
+
+// dst = (dst * (256 - a) + color * a) >> 8 per channel; pixels must be distinct.
+static void BlendPixels(uint32_t* const* pixels, const uint16_t* alpha, int count, uint32_t color) {
+    int i = 0;
+#if defined(ENGINE_FILL_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i source = _mm_unpacklo_epi8(_mm_set1_epi32((int)color), zero);
+    const __m128i one = _mm_set1_epi16(CoverageOne);
+    for (; i + 4 <= count; i += 4) {
+        __m128i dst = _mm_set_epi32((int)*pixels[i + 3], (int)*pixels[i + 2], (int)*pixels[i + 1], (int)*pixels[i]);
+        __m128i alphaLow = _mm_set_epi16(alpha[i + 1], alpha[i + 1], alpha[i + 1], alpha[i + 1], alpha[i], alpha[i], alpha[i], alpha[i]);
+        __m128i alphaHigh = _mm_set_epi16(alpha[i + 3], alpha[i + 3], alpha[i + 3], alpha[i + 3], alpha[i + 2], alpha[i + 2], alpha[i + 2], alpha[i + 2]);
+        // At most 255 * 256, so the unsigned 16-bit sums cannot wrap.
+        __m128i low = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(dst, zero), _mm_sub_epi16(one, alphaLow)), _mm_mullo_epi16(source, alphaLow));
+        __m128i high = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(dst, zero), _mm_sub_epi16(one, alphaHigh)), _mm_mullo_epi16(source, alphaHigh));
+        __m128i result = _mm_packus_epi16(_mm_srli_epi16(low, 8), _mm_srli_epi16(high, 8));
+        *pixels[i] = (uint32_t)_mm_cvtsi128_si32(result);
+        *pixels[i + 1] = (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(result, 4));
+        *pixels[i + 2] = (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(result, 8));
+        *pixels[i + 3] = (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(result, 12));
+    }
+#elif defined(ENGINE_FILL_NEON)
+    const uint16x8_t source = vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(color)));
+    const uint16x8_t one = vdupq_n_u16(CoverageOne);
+    for (; i + 4 <= count; i += 4) {
+        uint32_t gathered[4] = { *pixels[i], *pixels[i + 1], *pixels[i + 2], *pixels[i + 3] };
+        uint8x16_t dst = vreinterpretq_u8_u32(vld1q_u32(gathered));
+        uint16x8_t alphaLow = vcombine_u16(vdup_n_u16(alpha[i]), vdup_n_u16(alpha[i + 1]));
+        uint16x8_t alphaHigh = vcombine_u16(vdup_n_u16(alpha[i + 2]), vdup_n_u16(alpha[i + 3]));
+        uint16x8_t low = vmlaq_u16(vmulq_u16(vmovl_u8(vget_low_u8(dst)), vsubq_u16(one, alphaLow)), source, alphaLow);
+        uint16x8_t high = vmlaq_u16(vmulq_u16(vmovl_u8(vget_high_u8(dst)), vsubq_u16(one, alphaHigh)), source, alphaHigh);
+        vst1q_u32(gathered, vreinterpretq_u32_u8(vcombine_u8(vshrn_n_u16(low, 8), vshrn_n_u16(high, 8))));
+        *pixels[i] = gathered[0];
+        *pixels[i + 1] = gathered[1];
+        *pixels[i + 2] = gathered[2];
+        *pixels[i + 3] = gathered[3];
+    }
+#endif
+    for (; i < count; ++i) {
+        uint32_t dst = *pixels[i], result = 0;
+        for (int shift = 0; shift < 24; shift += 8) {
+            uint32_t d = (dst >> shift) & 0xFF, s = (color >> shift) & 0xFF;
+            result |= ((d * (CoverageOne - alpha[i]) + s * alpha[i]) >> 8) << shift;
+        }
+        *pixels[i] = result;
+    }
+}
+
+void DrawLineAA(Framebuffer& framebuffer, float x1, float y1, float x2, float y2, uint32_t color) {
+    DrawLineAA(framebuffer, x1, y1, x2, y2, color, framebuffer.getBounds());
+}
+
+void DrawLineAA(Framebuffer& framebuffer, float x1, float y1, float x2, float y2, uint32_t color, const ScreenRect& clip) {
+    if (clip.left >= clip.right || clip.top >= clip.bottom) return;
+    // Also rejects NaN.
+    if (!(std::fabs(x1) <= MaxFillCoordinate && std::fabs(y1) <= MaxFillCoordinate &&
+          std::fabs(x2) <= MaxFillCoordinate && std::fabs(y2) <= MaxFillCoordinate)) return;
+
+    // Work in coordinates where pixel centres are integers, x as the major axis.
+    x1 -= 0.5f; y1 -= 0.5f; x2 -= 0.5f; y2 -= 0.5f;
+    bool steep = std::fabs(y2 - y1) > std::fabs(x2 - x1);
+    if (steep) {
+        std::swap(x1, y1);
+        std::swap(x2, y2);
+    }
+    if (x1 > x2) {
+        std::swap(x1, x2);
+        std::swap(y1, y2);
+    }
+    float gradient = x2 > x1 ? (y2 - y1) / (x2 - x1) : 0.0f;
+    int majorLow = steep ? clip.top : clip.left, majorHigh = (steep ? clip.bottom : clip.right) - 1;
+    int minorLow = steep ? clip.left : clip.top, minorHigh = (steep ? clip.right : clip.bottom) - 1;
+
+    // Steps whose intercept can reach the clip's minor range, padded by one
+    // step for rounding; the per-pixel test below is the exact one.
+    float firstStep = std::max(std::floor(x1 + 0.5f), (float)majorLow);
+    float lastStep = std::min(std::floor(x2 + 0.5f), (float)majorHigh);
+    if (gradient != 0.0f) {
+        float a = x1 + (minorLow - 1 - y1) / gradient, b = x1 + (minorHigh + 1 - y1) / gradient;
+        firstStep = std::max(firstStep, std::floor(std::min(a, b)) - 1);
+        lastStep = std::min(lastStep, std::ceil(std::max(a, b)) + 1);
+    }
+    if (firstStep > lastStep) return;
+
+    uint32_t* pixels = framebuffer.getPixels();
+    size_t pitch = (size_t)framebuffer.getPitch();
+    uint32_t* batch[BlendBatchSize + 2];
+    uint16_t alpha[BlendBatchSize + 2];
+    int count = 0;
+    for (int m = (int)firstStep, last = (int)lastStep; m <= last; ++m) {
+        float intercept = y1 + gradient * (m - x1);
+        float span = std::max(0.0f, std::min(m + 0.5f, x2) - std::max(m - 0.5f, x1));
+        if (x1 == x2) span = 1.0f;
+        float base = std::floor(intercept);
+        float weight = (intercept - base) * span * CoverageOne;
+        // Rounded so the pair never sums to more than the step's coverage.
+        int above = int(weight + 0.5f), below = int(span * CoverageOne + 0.5f) - above;
+        int r = (int)base;
+        if (below > 0 && r >= minorLow && r <= minorHigh) {
+            batch[count] = steep ? pixels + size_t(m) * pitch + r : pixels + size_t(r) * pitch + m;
+            alpha[count++] = (uint16_t)below;
+        }
+        if (above > 0 && r + 1 >= minorLow && r + 1 <= minorHigh) {
+            batch[count] = steep ? pixels + size_t(m) * pitch + r + 1 : pixels + size_t(r + 1) * pitch + m;
+            alpha[count++] = (uint16_t)above;
+        }
+        if (count >= BlendBatchSize) {
+            BlendPixels(batch, alpha, count, color);
+            count = 0;
+        }
+    }
+    BlendPixels(batch, alpha, count, color);
+}
+
+void DrawTriangleAA(Framebuffer& framebuffer, const vec3d& p1, const vec3d& p2, const vec3d& p3, uint32_t color) {
+    DrawTriangleAA(framebuffer, p1, p2, p3, color, framebuffer.getBounds());
+}
+
+void DrawTriangleAA(Framebuffer& framebuffer, const vec3d& p1, const vec3d& p2, const vec3d& p3, uint32_t color, const ScreenRect& clip) {
+    DrawLineAA(framebuffer, p1.x, p1.y, p2.x, p2.y, color, clip);
+    DrawLineAA(framebuffer, p2.x, p2.y, p3.x, p3.y, color, clip);
+    DrawLineAA(framebuffer, p3.x, p3.y, p1.x, p1.y, color, clip);
+}
+
+// ---------------------------------------------------------------------------
+// Half-space fill. The bounding box is walked in 8x8 blocks: a block that lies
+// outside any edge is skipped, edges that contain a whole block drop out of its
+// per-pixel test, and the remaining coverage and depth tests run four lanes at
+// a time. Depth is tested before anything is written, so hidden pixels cost
+// neither a color nor a depth store.
+
+static const int SubPixelBits = 4;
+static const int SubPixelScale = 1 << SubPixelBits;
+// Blocks match the framebuffer's coarse depth blocks so each can be tested and
+// refreshed against exactly one coarse bound.
+static const int BlockSize = Framebuffer::CoarseBlockSize;
+
+namespace {
+// E(px, py) = a * px + b * py + c at the centre of pixel (px, py); the pixel is
+// inside the edge when E >= 0. a and b are per-pixel steps in 24.8 units.
+struct EdgeFunction {
+    int64_t a, b, c;
+
+    EdgeFunction(int64_t x0, int64_t y0, int64_t x1, int64_t y1) {
+        int64_t dx = x1 - x0, dy = y1 - y0;
+        a = -dy * SubPixelScale;
+        b = dx * SubPixelScale;
+        c = dy * x0 - dx * y0;
+        // Top-left rule: pixels exactly on an edge belong to the triangle only
+        // for top edges (horizontal, interior below) and left edges (going up).
+        bool topLeft = dy < 0 || (dy == 0 && dx > 0);
+        if (!topLeft) c -= 1;
+    }
+
+    int64_t evaluate(int px, int py) const { return a * px + b * py + c; }
+    int64_t minOffset() const { return (a < 0 ? a : 0) * (BlockSize - 1) + (b < 0 ? b : 0) * (BlockSize - 1); }
+    int64_t maxOffset() const { return (a > 0 ? a : 0) * (BlockSize - 1) + (b > 0 ? b : 0) * (BlockSize - 1); }
+};
+
+// Edge and depth values at the first pixel of a block, plus their per-pixel steps.
+struct BlockSetup {
+    int32_t e[3], stepX[3], stepY[3];
+    float z, dzdx, dzdy;
+};
+}
+
+// Writes `color` and depth to the pixels of the 8-pixel-wide block at column x,
+// rows [rowBegin, rowEnd), that are inside all three edges, nearer than the
+// stored depth and within [clipLeft, clipRight). With a sample buffer, pixels
+// that hold their own samples are skipped. Returns whether any was written.
+#if defined(ENGINE_FILL_SSE2)
+static bool FillBlock(Framebuffer& framebuffer, const SampleBuffer* samples, int x, int rowBegin, int rowEnd, const BlockSetup& block, int clipLeft, int clipRight, uint32_t color) {
+    const __m128i lane = _mm_setr_epi32(0, 1, 2, 3);
+    const __m128 laneF = _mm_setr_ps(0, 1, 2, 3);
+    __m128i mask[2], values[3][2], stepRow[3];
+    __m128 z[2];
+    for (int half = 0; half < 2; ++half) {
+        __m128i columns = _mm_add_epi32(_mm_set1_epi32(x + half * 4), lane);
+        mask[half] = _mm_and_si128(_mm_cmpgt_epi32(columns, _mm_set1_epi32(clipLeft - 1)), _mm_cmplt_epi32(columns, _mm_set1_epi32(clipRight)));
+        z[half] = _mm_add_ps(_mm_set1_ps(block.z + block.dzdx * (half * 4)), _mm_mul_ps(_mm_set1_ps(block.dzdx), laneF));
+    }
+    for (int k = 0; k < 3; ++k) {
+        // e + stepX * lane without SSE4.1's 32-bit multiply.
+        __m128i step = _mm_set1_epi32(block.stepX[k]);
+        __m128i first = _mm_add_epi32(_mm_set1_epi32(block.e[k]), _mm_and_si128(step, _mm_setr_epi32(0, -1, -1, -1)));
+        first = _mm_add_epi32(first, _mm_and_si128(step, _mm_setr_epi32(0, 0, -1, -1)));
+        first = _mm_add_epi32(first, _mm_and_si128(step, _mm_setr_epi32(0, 0, 0, -1)));
+        values[k][0] = first;
+        values[k][1] = _mm_add_epi32(first, _mm_slli_epi32(step, 2));
+        stepRow[k] = _mm_set1_epi32(block.stepY[k]);
+    }
+
+    __m128i fill = _mm_set1_epi32((int)color);
+    __m128 zStepRow = _mm_set1_ps(block.dzdy);
+    bool written = false;
+    __m128i uniform[2] = { _mm_set1_epi32(-1), _mm_set1_epi32(-1) };
+    for (int y = rowBegin; y < rowEnd; ++y) {
+        uint32_t* row = framebuffer.getRow(y) + x;
+        float* depthRow = framebuffer.getDepthRow(y) + x;
+        if (samples) {
+            __m128i slots = _mm_load_si128(reinterpret_cast<const __m128i*>(samples->getSlotRow(y) + x));
+            __m128i single = _mm_cmpeq_epi16(slots, _mm_set1_epi16(-1));
+            uniform[0] = _mm_unpacklo_epi16(single, single);
+            uniform[1] = _mm_unpackhi_epi16(single, single);
+        }
+        for (int half = 0; half < 2; ++half) {
+            __m128i signs = _mm_or_si128(_mm_or_si128(values[0][half], values[1][half]), values[2][half]);
+            __m128i covered = _mm_andnot_si128(_mm_srai_epi32(signs, 31), mask[half]);
+            covered = _mm_and_si128(covered, uniform[half]);
+            if (_mm_movemask_epi8(covered) == 0) continue;
+            __m128 oldDepth = _mm_load_ps(depthRow + half * 4);
+            __m128i visible = _mm_and_si128(covered, _mm_castps_si128(_mm_cmplt_ps(z[half], oldDepth)));
+            if (_mm_movemask_epi8(visible) == 0) continue;
+            __m128 visibleF = _mm_castsi128_ps(visible);
+            _mm_store_ps(depthRow + half * 4, _mm_or_ps(_mm_and_ps(visibleF, z[half]), _mm_andnot_ps(visibleF, oldDepth)));
+            __m128i* pixels = reinterpret_cast<__m128i*>(row + half * 4);
+            _mm_store_si128(pixels, _mm_or_si128(_mm_and_si128(visible, fill), _mm_andnot_si128(visible, _mm_load_si128(pixels))));
+            written = true;
+        }
+        for (int k = 0; k < 3; ++k) {
+            values[k][0] = _mm_add_epi32(values[k][0], stepRow[k]);
+            values[k][1] = _mm_add_epi32(values[k][1], stepRow[k]);
+        }
+        z[0] = _mm_add_ps(z[0], zStepRow);
+        z[1] = _mm_add_ps(z[1], zStepRow);
+    }
+    return written;
+}
+#elif defined(ENGINE_FILL_NEON)
+static bool FillBlock(Framebuffer& framebuffer, const SampleBuffer* samples, int x, int rowBegin, int rowEnd, const BlockSetup& block, int clipLeft, int clipRight, uint32_t color) {
+    const int32_t laneIndex[4] = { 0, 1, 2, 3 };
+    int32x4_t lane = vld1q_s32(laneIndex);
+    float32x4_t laneF = vcvtq_f32_s32(lane);
+    uint32x4_t mask[2];
+    int32x4_t values[3][2];
+    float32x4_t z[2];
+    for (int half = 0; half < 2; ++half) {
+        int32x4_t columns = vaddq_s32(vdupq_n_s32(x + half * 4), lane);
+        mask[half] = vandq_u32(vcgeq_s32(columns, vdupq_n_s32(clipLeft)), vcltq_s32(columns, vdupq_n_s32(clipRight)));
+        z[half] = vmlaq_n_f32(vdupq_n_f32(block.z + block.dzdx * (half * 4)), laneF, block.dzdx);
+        for (int k = 0; k < 3; ++k) {
+            values[k][half] = vmlaq_n_s32(vdupq_n_s32(block.e[k] + block.stepX[k] * half * 4), lane, block.stepX[k]);
+        }
+    }
+
+    uint32x4_t fill = vdupq_n_u32(color);
+    bool written = false;
+    uint32x4_t uniform[2] = { vdupq_n_u32(0xFFFFFFFFu), vdupq_n_u32(0xFFFFFFFFu) };
+    for (int y = rowBegin; y < rowEnd; ++y) {
+        uint32_t* row = framebuffer.getRow(y) + x;
+        float* depthRow = framebuffer.getDepthRow(y) + x;
+        if (samples) {
+            uint16x8_t slots = vld1q_u16(samples->getSlotRow(y) + x);
+            uniform[0] = vceqq_u32(vmovl_u16(vget_low_u16(slots)), vdupq_n_u32(SampleBuffer::Uniform));
+            uniform[1] = vceqq_u32(vmovl_u16(vget_high_u16(slots)), vdupq_n_u32(SampleBuffer::Uniform));
+        }
+        for (int half = 0; half < 2; ++half) {
+            int32x4_t signs = vorrq_s32(vorrq_s32(values[0][half], values[1][half]), values[2][half]);
+            uint32x4_t covered = vandq_u32(vandq_u32(vcgeq_s32(signs, vdupq_n_s32(0)), mask[half]), uniform[half]);
+            if (vmaxvq_u32(covered) == 0) continue;
+            float32x4_t oldDepth = vld1q_f32(depthRow + half * 4);
+            uint32x4_t visible = vandq_u32(covered, vcltq_f32(z[half], oldDepth));
+            if (vmaxvq_u32(visible) == 0) continue;
+            vst1q_f32(depthRow + half * 4, vbslq_f32(visible, z[half], oldDepth));
+            vst1q_u32(row + half * 4, vbslq_u32(visible, fill, vld1q_u32(row + half * 4)));
+            written = true;
+        }
+        for (int k = 0; k < 3; ++k) {
+            values[k][0] = vaddq_s32(values[k][0], vdupq_n_s32(block.stepY[k]));
+            values[k][1] = vaddq_s32(values[k][1], vdupq_n_s32(block.stepY[k]));
+        }
+        z[0] = vaddq_f32(z[0], vdupq_n_f32(block.dzdy));
+        z[1] = vaddq_f32(z[1], vdupq_n_f32(block.dzdy));
+    }
+    return written;
+}
+#else
+static bool FillBlock(Framebuffer& framebuffer, const SampleBuffer* samples, int x, int rowBegin, int rowEnd, const BlockSetup& block, int clipLeft, int clipRight, uint32_t color) {
+    int begin = std::max(x, clipLeft);
+    int end = std::min(x + BlockSize, clipRight);
+    bool written = false;
+    for (int y = rowBegin; y < rowEnd; ++y) {
+        int32_t rowOffset = y - rowBegin;
+        uint32_t* row = framebuffer.getRow(y);
+        float* depthRow = framebuffer.getDepthRow(y);
+        const uint16_t* slots = samples ? samples->getSlotRow(y) : nullptr;
+        for (int px = begin; px < end; ++px) {
+            int32_t column = px - x;
+            int32_t e0 = block.e[0] + block.stepX[0] * column + block.stepY[0] * rowOffset;
+            int32_t e1 = block.e[1] + block.stepX[1] * column + block.stepY[1] * rowOffset;
+            int32_t e2 = block.e[2] + block.stepX[2] * column + block.stepY[2] * rowOffset;
+            if ((e0 | e1 | e2) < 0) continue;
+            if (slots && slots[px] != SampleBuffer::Uniform) continue;
+            float z = block.z + block.dzdx * column + block.dzdy * rowOffset;
+            if (z < depthRow[px]) {
+                depthRow[px] = z;
+                row[px] = color;
+                written = true;
+            }
+        }
+    }
+    return written;
+}
+#endif
+
+namespace {
+// Per-sample offsets of one triangle's edge values and depth from the pixel
+// centre. A pixel is inside edge k on every sample when its centre value is at
+// least allInside[k], and on none when it is below anyInside[k].
+struct SampleSetup {
+    int count;
+    int32_t e[3][SampleBuffer::MaxSamples];
+    float z[SampleBuffer::MaxSamples];
+    int32_t allInside[3], anyInside[3];
+};
+}
+
+// Per row of the block, the pixels that need per-sample work: inside every
+// edge on some sample, and either not on all of them or already expanded.
+// fullyCovered marks the pixels inside on every sample. Bit i is column i.
+#if defined(ENGINE_FILL_SSE2)
+static void FindSampleCandidates(const SampleBuffer& samples, int x, int rowBegin, int rowEnd, const BlockSetup& block, const int32_t anyInside[3], const int32_t allInside[3], uint32_t* candidates, uint32_t* fullyCovered) {
+    __m128i anyValues[3][2], allValues[3][2], stepRow[3];
+    for (int k = 0; k < 3; ++k) {
+        __m128i step = _mm_set1_epi32(block.stepX[k]);
+        __m128i first = _mm_add_epi32(_mm_set1_epi32(block.e[k]), _mm_and_si128(step, _mm_setr_epi32(0, -1, -1, -1)));
+        first = _mm_add_epi32(first, _mm_and_si128(step, _mm_setr_epi32(0, 0, -1, -1)));
+        first = _mm_add_epi32(first, _mm_and_si128(step, _mm_setr_epi32(0, 0, 0, -1)));
+        __m128i second = _mm_add_epi32(first, _mm_slli_epi32(step, 2));
+        anyValues[k][0] = _mm_sub_epi32(first, _mm_set1_epi32(anyInside[k]));
+        anyValues[k][1] = _mm_sub_epi32(second, _mm_set1_epi32(anyInside[k]));
+        allValues[k][0] = _mm_sub_epi32(first, _mm_set1_epi32(allInside[k]));
+        allValues[k][1] = _mm_sub_epi32(second, _mm_set1_epi32(allInside[k]));
+        stepRow[k] = _mm_set1_epi32(block.stepY[k]);
+    }
+    for (int y = rowBegin; y < rowEnd; ++y) {
+        __m128i anySigns[2], allSigns[2];
+        for (int half = 0; half < 2; ++half) {
+            anySigns[half] = _mm_or_si128(_mm_or_si128(anyValues[0][half], anyValues[1][half]), anyValues[2][half]);
+            allSigns[half] = _mm_or_si128(_mm_or_si128(allValues[0][half], allValues[1][half]), allValues[2][half]);
+        }
+        uint32_t outside = uint32_t(_mm_movemask_ps(_mm_castsi128_ps(anySigns[0])) | (_mm_movemask_ps(_mm_castsi128_ps(anySigns[1])) << 4));
+        uint32_t partial = uint32_t(_mm_movemask_ps(_mm_castsi128_ps(allSigns[0])) | (_mm_movemask_ps(_mm_castsi128_ps(allSigns[1])) << 4));
+        __m128i slots = _mm_load_si128(reinterpret_cast<const __m128i*>(samples.getSlotRow(y) + x));
+        __m128i single = _mm_cmpeq_epi16(slots, _mm_set1_epi16(-1));
+        uint32_t expanded = ~uint32_t(_mm_movemask_epi8(_mm_packs_epi16(single, single))) & 0xFF;
+        candidates[y - rowBegin] = ~outside & (partial | expanded) & 0xFF;
+        fullyCovered[y - rowBegin] = ~partial & 0xFF;
+        for (int k = 0; k < 3; ++k) {
+            for (int half = 0; half < 2; ++half) {
+                anyValues[k][half] = _mm_add_epi32(anyValues[k][half], stepRow[k]);
+                allValues[k][half] = _mm_add_epi32(allValues[k][half], stepRow[k]);
+            }
+        }
+    }
+}
+#elif defined(ENGINE_FILL_NEON)
+static void FindSampleCandidates(const SampleBuffer& samples, int x, int rowBegin, int rowEnd, const BlockSetup& block, const int32_t anyInside[3], const int32_t allInside[3], uint32_t* candidates, uint32_t* fullyCovered) {
+    const int32_t laneIndex[4] = { 0, 1, 2, 3 };
+    const uint32_t laneBit[4] = { 1, 2, 4, 8 };
+    const uint16_t columnBit[8] = { 1, 2, 4, 8, 16, 32, 64, 128 };
+    int32x4_t lane = vld1q_s32(laneIndex);
+    uint32x4_t bits = vld1q_u32(laneBit);
+    uint16x8_t columnBits = vld1q_u16(columnBit);
+    int32x4_t anyValues[3][2], allValues[3][2];
+    for (int half = 0; half < 2; ++half) {
+        for (int k = 0; k < 3; ++k) {
+            int32x4_t values = vmlaq_n_s32(vdupq_n_s32(block.e[k] + block.stepX[k] * half * 4), lane, block.stepX[k]);
+            anyValues[k][half] = vsubq_s32(values, vdupq_n_s32(anyInside[k]));
+            allValues[k][half] = vsubq_s32(values, vdupq_n_s32(allInside[k]));
+        }
+    }
+    for (int y = rowBegin; y < rowEnd; ++y) {
+        uint32_t outside = 0, partial = 0;
+        for (int half = 0; half < 2; ++half) {
+            int32x4_t anySigns = vorrq_s32(vorrq_s32(anyValues[0][half], anyValues[1][half]), anyValues[2][half]);
+            int32x4_t allSigns = vorrq_s32(vorrq_s32(allValues[0][half], allValues[1][half]), allValues[2][half]);
+            outside |= vaddvq_u32(vandq_u32(vcltq_s32(anySigns, vdupq_n_s32(0)), bits)) << (half * 4);
+            partial |= vaddvq_u32(vandq_u32(vcltq_s32(allSigns, vdupq_n_s32(0)), bits)) << (half * 4);
+        }
+        uint16x8_t slots = vld1q_u16(samples.getSlotRow(y) + x);
+        uint32_t expanded = vaddvq_u16(vandq_u16(vmvnq_u16(vceqq_u16(slots, vdupq_n_u16(SampleBuffer::Uniform))), columnBits));
+        candidates[y - rowBegin] = ~outside & (partial | expanded) & 0xFF;
+        fullyCovered[y - rowBegin] = ~partial & 0xFF;
+        for (int k = 0; k < 3; ++k) {
+            for (int half = 0; half < 2; ++half) {
+                anyValues[k][half] = vaddq_s32(anyValues[k][half], vdupq_n_s32(block.stepY[k]));
+                allValues[k][half] = vaddq_s32(allValues[k][half], vdupq_n_s32(block.stepY[k]));
+            }
+        }
+    }
+}
+#else
+static void FindSampleCandidates(const SampleBuffer& samples, int x, int rowBegin, int rowEnd, const BlockSetup& block, const int32_t anyInside[3], const int32_t allInside[3], uint32_t* candidates, uint32_t* fullyCovered) {
+    for (int y = rowBegin; y < rowEnd; ++y) {
+        int32_t rowOffset = y - rowBegin;
+        const uint16_t* slotRow = samples.getSlotRow(y) + x;
+        uint32_t rowCandidates = 0, rowCovered = 0;
+        for (int column = 0; column < BlockSize; ++column) {
+            int32_t e0 = block.e[0] + block.stepX[0] * column + block.stepY[0] * rowOffset;
+            int32_t e1 = block.e[1] + block.stepX[1] * column + block.stepY[1] * rowOffset;
+            int32_t e2 = block.e[2] + block.stepX[2] * column + block.stepY[2] * rowOffset;
+            bool any = ((e0 - anyInside[0]) | (e1 - anyInside[1]) | (e2 - anyInside[2])) >= 0;
+            bool all = ((e0 - allInside[0]) | (e1 - allInside[1]) | (e2 - allInside[2])) >= 0;
+            bool expanded = slotRow[column] != SampleBuffer::Uniform;
+            rowCandidates |= uint32_t(any && (!all || expanded)) << column;
+            rowCovered |= uint32_t(all) << column;
+        }
+        candidates[rowOffset] = rowCandidates;
+        fullyCovered[rowOffset] = rowCovered;
+    }
+}
+#endif
+
+// The per-sample half of a multisampled block: pixels the triangle covers only
+// partly, or that already hold their own samples, are tested per sample. A
+// partly covered single-valued pixel is expanded first. Single-valued pixels
+// covered on every sample are left to FillBlock. Returns whether anything was written.
+static bool FillBlockSamples(Framebuffer& framebuffer, SampleBuffer& samples, int x, int rowBegin, int rowEnd, const BlockSetup& block, const SampleSetup& offsets, int clipLeft, int clipRight, uint32_t color) {
+    int begin = std::max(x, clipLeft);
+    int end = std::min(x + BlockSize, clipRight);
+    uint32_t allSamples = (1u << offsets.count) - 1;
+    // Edges the whole block is inside of were dropped from the setup; drop their sample offsets too.
+    int32_t sampleE[3][SampleBuffer::MaxSamples], allInside[3], anyInside[3];
+    for (int k = 0; k < 3; ++k) {
+        bool dropped = block.stepX[k] == 0 && block.stepY[k] == 0;
+        for (int s = 0; s < offsets.count; ++s) sampleE[k][s] = dropped ? 0 : offsets.e[k][s];
+        allInside[k] = dropped ? 0 : offsets.allInside[k];
+        anyInside[k] = dropped ? 0 : offsets.anyInside[k];
+    }
+    // Columns of the block inside the clip.
+    uint32_t clipColumns = ((1u << (end - x)) - 1) & ~((1u << (begin - x)) - 1);
+    // Blocks never straddle tiles.
+    int tile = samples.getTile(x, rowBegin);
+    uint32_t rowCandidates[BlockSize], rowCovered[BlockSize];
+    FindSampleCandidates(samples, x, rowBegin, rowEnd, block, anyInside, allInside, rowCandidates, rowCovered);
+    bool written = false;
+    for (int y = rowBegin; y < rowEnd; ++y) {
+        int32_t rowOffset = y - rowBegin;
+        if ((rowCandidates[rowOffset] & clipColumns) == 0) continue;
+        uint32_t* row = framebuffer.getRow(y);
+        float* depthRow = framebuffer.getDepthRow(y);
+        const uint16_t* slotRow = samples.getSlotRow(y) + x;
+        int32_t rowE[3];
+        for (int k = 0; k < 3; ++k) rowE[k] = block.e[k] + block.stepY[k] * rowOffset;
+        uint32_t candidates = rowCandidates[rowOffset] & clipColumns, fullyCovered = rowCovered[rowOffset];
+
+        for (int column = 0; candidates != 0; ++column, candidates >>= 1, fullyCovered >>= 1) {
+            if ((candidates & 1) == 0) continue;
+            int px = x + column;
+            uint32_t covered = allSamples;
+            if ((fullyCovered & 1) == 0) {
+                int32_t e0 = rowE[0] + block.stepX[0] * column;
+                int32_t e1 = rowE[1] + block.stepX[1] * column;
+                int32_t e2 = rowE[2] + block.stepX[2] * column;
+                covered = 0;
+                for (int s = 0; s < offsets.count; ++s) {
+                    int32_t signs = (e0 + sampleE[0][s]) | (e1 + sampleE[1][s]) | (e2 + sampleE[2][s]);
+                    covered |= uint32_t(signs >= 0) << s;
+                }
+                if (covered == 0) continue;
+            }
+
+            float z = block.z + block.dzdx * column + block.dzdy * rowOffset;
+            uint16_t slot = slotRow[column];
+            if (slot == SampleBuffer::Uniform) {
+                bool nearer = false;
+                for (int s = 0; s < offsets.count && !nearer; ++s) {
+                    nearer = ((covered >> s) & 1) && z + offsets.z[s] < depthRow[px];
+                }
+                if (!nearer) continue;
+                slot = samples.expand(tile, px, y, row[px], depthRow[px]);
+            }
+
+            uint32_t* colors = samples.getColors(tile, slot);
+            float* depths = samples.getDepths(tile, slot);
+            float farthest = -Framebuffer::FarDepth;
+            bool any = false;
+            for (int s = 0; s < offsets.count; ++s) {
+                float sampleZ = z + offsets.z[s];
+                if (((covered >> s) & 1) && sampleZ < depths[s]) {
+                    depths[s] = sampleZ;
+                    colors[s] = color;
+                    any = true;
+                }
+                farthest = std::max(farthest, depths[s]);
+            }
+            if (any) {
+                depthRow[px] = farthest;
+                written = true;
+            }
+        }
+    }
+    return written;
+}
+
+// Shared by the single- and multisampled fills; samples is null for the former.
+static void RasterizeTriangle(Framebuffer& framebuffer, SampleBuffer* samples, const vec3d& p1, const vec3d& p2, const vec3d& p3, uint32_t color, const ScreenRect& clip) {
+    const vec3d* v[3] = { &p1, &p2, &p3 };
+    int64_t fx[3], fy[3];
+    for (int i = 0; i < 3; ++i) {
+        // Written this way round so NaN coordinates are rejected as well.
+        if (!(std::fabs(v[i]->x) < MaxFillCoordinate && std::fabs(v[i]->y) < MaxFillCoordinate)) return;
+        // Pixel centres sit at integer + 0.5 in the incoming coordinates.
+        fx[i] = std::lrint((v[i]->x - 0.5f) * SubPixelScale);
+        fy[i] = std::lrint((v[i]->y - 0.5f) * SubPixelScale);
+    }
+
+    int64_t area = (fx[1] - fx[0]) * (fy[2] - fy[0]) - (fy[1] - fy[0]) * (fx[2] - fx[0]);
+    if (area == 0) return;
+    if (area < 0) {
+        std::swap(v[1], v[2]);
+        std::swap(fx[1], fx[2]);
+        std::swap(fy[1], fy[2]);
+        area = -area;
+    }
+
+    int minX = std::max(clip.left, (int)((std::min({ fx[0], fx[1], fx[2] }) >> SubPixelBits)));
+    int minY = std::max(clip.top, (int)((std::min({ fy[0], fy[1], fy[2] }) >> SubPixelBits)));
+    int maxX = std::min(clip.right - 1, (int)((std::max({ fx[0], fx[1], fx[2] }) + SubPixelScale - 1) >> SubPixelBits));
+    int maxY = std::min(clip.bottom - 1, (int)((std::max({ fy[0], fy[1], fy[2] }) + SubPixelScale - 1) >> SubPixelBits));
+    if (samples) {
+        // Samples reach half a pixel past the centres the bounds were taken on.
+        minX = std::max(clip.left, minX - 1);
+        minY = std::max(clip.top, minY - 1);
+        maxX = std::min(clip.right - 1, maxX + 1);
+        maxY = std::min(clip.bottom - 1, maxY + 1);
+    }
+    if (minX > maxX || minY > maxY) return;
+
+    // Each edge runs from vertex i to i+1 with the interior on its non-negative side.
+    const EdgeFunction edges[3] = {
+        EdgeFunction(fx[0], fy[0], fx[1], fy[1]),
+        EdgeFunction(fx[1], fy[1], fx[2], fy[2]),
+        EdgeFunction(fx[2], fy[2], fx[0], fy[0]),
+    };
+
+    // Projected depth is affine in screen space, so it is a plane through the
+    // snapped vertices: z(px, py) = z0 + dzdx * (px - x0) + dzdy * (py - y0).
+    float x0 = fx[0] * (1.0f / SubPixelScale), y0 = fy[0] * (1.0f / SubPixelScale);
+    float x1 = fx[1] * (1.0f / SubPixelScale) - x0, y1 = fy[1] * (1.0f / SubPixelScale) - y0;
+    float x2 = fx[2] * (1.0f / SubPixelScale) - x0, y2 = fy[2] * (1.0f / SubPixelScale) - y0;
+    float z0 = v[0]->z, z1 = v[1]->z - z0, z2 = v[2]->z - z0;
+    float invArea = (float)(SubPixelScale * SubPixelScale) / (float)area;
+    float dzdx = (z1 * y2 - z2 * y1) * invArea;
+    float dzdy = (z2 * x1 - z1 * x2) * invArea;
+    float nearestZ = std::min({ v[0]->z, v[1]->z, v[2]->z });
+
+    // Sample offsets are in 1/16 pixel and a, b are multiples of SubPixelScale,
+    // so the per-sample edge offsets are exact. margin bounds them per edge.
+    SampleSetup offsets = {};
+    int64_t margin[3] = { 0, 0, 0 };
+    float depthMargin = 0;
+    if (samples) {
+        static_assert(SubPixelScale == 16, "sample patterns are in 1/16 pixel");
+        const int8_t (*pattern)[2] = SampleBuffer::getPattern(samples->getSampleCount());
+        offsets.count = samples->getSampleCount();
+        for (int s = 0; s < offsets.count; ++s) {
+            for (int k = 0; k < 3; ++k) {
+                offsets.e[k][s] = (int32_t)((edges[k].a * pattern[s][0] + edges[k].b * pattern[s][1]) / SubPixelScale);
+            }
+            offsets.z[s] = (dzdx * pattern[s][0] + dzdy * pattern[s][1]) * (1.0f / SubPixelScale);
+        }
+        for (int k = 0; k < 3; ++k) {
+            margin[k] = (std::abs(edges[k].a) + std::abs(edges[k].b)) / 2;
+            offsets.allInside[k] = -*std::min_element(offsets.e[k], offsets.e[k] + offsets.count);
+            offsets.anyInside[k] = -*std::max_element(offsets.e[k], offsets.e[k] + offsets.count);
+        }
+        depthMargin = 0.5f * (std::fabs(dzdx) + std::fabs(dzdy));
+    }
+
+    int blockX0 = minX & ~(BlockSize - 1);
+    int blockY0 = minY & ~(BlockSize - 1);
+    for (int by = blockY0; by <= maxY; by += BlockSize) {
+        int rowBegin = std::max(by, clip.top);
+        int rowEnd = std::min(by + BlockSize, clip.bottom);
+        for (int bx = blockX0; bx <= maxX; bx += BlockSize) {
+            BlockSetup block;
+            bool rejected = false, partial = false;
+            for (int k = 0; k < 3; ++k) {
+                int64_t origin = edges[k].evaluate(bx, rowBegin);
+                if (origin + edges[k].maxOffset() + margin[k] < 0) { rejected = true; break; }
+                if (origin + edges[k].minOffset() - margin[k] >= 0) {
+                    // Inside everywhere in the block: contributes nothing to the per-pixel test.
+                    block.e[k] = 0; block.stepX[k] = 0; block.stepY[k] = 0;
+                } else {
+                    // The edge crosses the block, so its values here are bounded by the block's extent.
+                    block.e[k] = (int32_t)origin; block.stepX[k] = (int32_t)edges[k].a; block.stepY[k] = (int32_t)edges[k].b;
+                    partial = true;
+                }
+            }
+            if (rejected) continue;
+
+            block.z = z0 + dzdx * (bx - x0) + dzdy * (rowBegin - y0);
+            block.dzdx = dzdx;
+            block.dzdy = dzdy;
+
+            // Coarse occlusion: both the plane's minimum over the block and the
+            // nearest vertex are lower bounds on the triangle's depth here.
+            float planeMin = block.z + std::min(0.0f, dzdx) * (BlockSize - 1) + std::min(0.0f, dzdy) * (rowEnd - rowBegin - 1) - depthMargin;
+            if (std::max(planeMin, nearestZ) >= framebuffer.getCoarseDepth(bx / BlockSize, by / BlockSize)) continue;
+
+            bool written;
+            if (!samples) {
+                written = FillBlock(framebuffer, nullptr, bx, rowBegin, rowEnd, block, clip.left, clip.right, color);
+            } else {
+                // Single-valued pixels covered on every sample fill exactly like
+                // single-sampled ones: shifting the crossing edges by their
+                // sample extent makes FillBlock select just them.
+                bool expanded = samples->isBlockExpanded(bx / BlockSize, by / BlockSize);
+                BlockSetup covered = block;
+                for (int k = 0; k < 3; ++k) {
+                    if (covered.stepX[k] != 0 || covered.stepY[k] != 0) covered.e[k] -= offsets.allInside[k];
+                }
+                written = FillBlock(framebuffer, expanded ? samples : nullptr, bx, rowBegin, rowEnd, covered, clip.left, clip.right, color);
+                if (partial || expanded) {
+                    written |= FillBlockSamples(framebuffer, *samples, bx, rowBegin, rowEnd, block, offsets, clip.left, clip.right, color);
+                }
+            }
+            if (!written) continue;
+            // Refresh the bound only when the whole block belongs to this clip;
+            // neighbouring clips may be written concurrently.
+            if (rowBegin == by && rowEnd == by + BlockSize && bx >= clip.left && bx + BlockSize <= clip.right && bx + BlockSize <= framebuffer.getWidth()) {
+                framebuffer.updateCoarseDepth(bx / BlockSize, by / BlockSize);
+            }
+        }
+    }
+}
+
+void FillTriangle(Framebuffer& framebuffer, const vec3d& p1, const vec3d& p2, const vec3d& p3, uint32_t color) {
+    RasterizeTriangle(framebuffer, nullptr, p1, p2, p3, color, framebuffer.getBounds());
+}
+
+void FillTriangle(Framebuffer& framebuffer, const vec3d& p1, const vec3d& p2, const vec3d& p3, uint32_t color, const ScreenRect& clip) {
+    RasterizeTriangle(framebuffer, nullptr, p1, p2, p3, color, clip);
+}
+
+void FillTriangle(Framebuffer& framebuffer, SampleBuffer& samples, const vec3d& p1, const vec3d& p2, const vec3d& p3, uint32_t color) {
+    RasterizeTriangle(framebuffer, &samples, p1, p2, p3, color, framebuffer.getBounds());
+}
+
+void FillTriangle(Framebuffer& framebuffer, SampleBuffer& samples, const vec3d& p1, const vec3d& p2, const vec3d& p3, uint32_t color, const ScreenRect& clip) {
+    RasterizeTriangle(framebuffer, &samples, p1, p2, p3, color, clip);
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+#include "Framebuffer.h"
+#include "Geometry.h"
+#include "SampleBuffer.h"
+
+// The clip variants only write pixels inside `clip`, which must lie within the
+// framebuffer. Tile jobs use them to rasterize disjoint screen regions in parallel.
+void DrawPixel(Framebuffer& framebuffer, int x, int y, uint32_t color);
+void DrawLine(Framebuffer& framebuffer, int x1, int y1, int x2, int y2, uint32_t color);
+void DrawLine(Framebuffer& framebuffer, int x1, int y1, int x2, int y2, uint32_t color, const ScreenRect& clip);
+void DrawTriangle(Framebuffer& framebuffer, const vec3d& p1, const vec3d& p2, const vec3d& p3, uint32_t color);
+void DrawTriangle(Framebuffer& framebuffer, const vec3d& p1, const vec3d& p2, const vec3d& p3, uint32_t color, const ScreenRect& clip);
+
+// Anti-aliased variants take unrounded screen coordinates and blend `color` over
+// the framebuffer by analytic pixel coverage (Xiaolin Wu's algorithm).
+void DrawLineAA(Framebuffer& framebuffer, float x1, float y1, float x2, float y2, uint32_t color);
+void DrawLineAA(Framebuffer& framebuffer, float x1, float y1, float x2, float y2, uint32_t color, const ScreenRect& clip);
+void DrawTriangleAA(Framebuffer& framebuffer, const vec3d& p1, const vec3d& p2, const vec3d& p3, uint32_t color);
+void DrawTriangleAA(Framebuffer& framebuffer, const vec3d& p1, const vec3d& p2, const vec3d& p3, uint32_t color, const ScreenRect& clip);
+
+// Solid triangle fill with edge functions in 28.4 fixed point and a top-left
+// fill rule, so triangles sharing an edge never touch the same pixel twice.
+// Either winding is accepted. z is interpolated across the triangle and a pixel
+// is written only where it is nearer than the framebuffer's depth, which is
+// updated as well. Coordinates farther than MaxFillCoordinate
+// pixels from the origin are rejected rather than overflowing the setup.
+constexpr float MaxFillCoordinate = 32768.0f;
+void FillTriangle(Framebuffer& framebuffer, const vec3d& p1, const vec3d& p2, const vec3d& p3, uint32_t color);
+void FillTriangle(Framebuffer& framebuffer, const vec3d& p1, const vec3d& p2, const vec3d& p3, uint32_t color, const ScreenRect& clip);
+
+// Multisampled fill: coverage and depth are evaluated at each of the sample
+// buffer's sample positions, the color once per triangle. Pixels the triangle
+// only partly covers get per-sample storage; resolve the tile before presenting.
+void FillTriangle(Framebuffer& framebuffer, SampleBuffer& samples, const vec3d& p1, const vec3d& p2, const vec3d& p3, uint32_t color);
+void FillTriangle(Framebuffer& framebuffer, SampleBuffer& samples, const vec3d& p1, const vec3d& p2, const vec3d& p3, uint32_t color, const ScreenRect& clip);
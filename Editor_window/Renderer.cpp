@@ -0,0 +1,705 @@
+#include "Renderer.h"
+#include <algorithm>
+#include <cmath>
+#include "Profiler.h"
+#include "Rasterizer.h"
+#include "VertexKernels.h"
+
+// Vertices per projection job; a multiple of VertexStreams::Lanes so every
+// job starts on an aligned vector.
+static const size_t VertexGrain = 16384;
+// Triangles per binning job; large enough to amortize scheduling, small
+// enough that one dense sphere still spreads over every worker.
+static const size_t BinningGrain = 4096;
+static const size_t EdgeGrain = 8192;
+// Pixels past each screen edge that triangles may reach before they are
+// clipped; keeps snapped coordinates well inside the rasterizer's range.
+constexpr float GuardBand = 8192.0f;
+static_assert(GuardBand * 2 <= MaxFillCoordinate, "the guard band leaves no room for the screen in the rasterizer's coordinate range");
+
+Renderer::Renderer(int width, int height, unsigned workerCount, bool pinThreads)
+    : WIDTH(width), HEIGHT(height), r(400),
+      tilesX((width + DefaultTileSize - 1) / DefaultTileSize), tilesY((height + DefaultTileSize - 1) / DefaultTileSize), framebuffer(width, height), pool(workerCount, pinThreads) {
+    tileCleared.assign(size_t(tilesX) * tilesY, 0);
+    tileDirty.assign(size_t(tilesX) * tilesY, 0);
+    camera.setViewport(width, height);
+    setProjection(70.0f, 16.0f / 9.0f, 8.0f);
+}
+
+void Renderer::addObject(Object* obj) {
+    objects.push_back(obj);
+}
+
+void Renderer::setProjection(float fieldOfView, float aspectRatio, float scale) {
+    float focalLength = fieldOfView * scale;
+    camera.setLens(focalLength, aspectRatio);
+    camera.setPosition(vec3d(0, 0, -focalLength));
+}
+
+void Renderer::setMultisampling(int sampleCount) {
+    if (!isValidSampleCount(sampleCount) || sampleCount == getMultisampling()) return;
+    invalidate();
+    if (sampleCount == 1) {
+        samples.reset();
+    } else {
+        samples = std::make_unique<SampleBuffer>(WIDTH, HEIGHT, sampleCount, tileSize);
+    }
+}
+
+void Renderer::setTileSize(int size) {
+    if (!isValidTileSize(size) || size == tileSize) return;
+    tileSize = size;
+    tilesX = (WIDTH + tileSize - 1) / tileSize;
+    tilesY = (HEIGHT + tileSize - 1) / tileSize;
+    tileCleared.assign(size_t(tilesX) * tilesY, 0);
+    tileDirty.assign(size_t(tilesX) * tilesY, 0);
+    invalidate();
+    // Sample pools are per tile, so they follow the new grid.
+    if (samples) {
+        samples = std::make_unique<SampleBuffer>(WIDTH, HEIGHT, samples->getSampleCount(), tileSize);
+    }
+}
+
+void Renderer::update() {
+    ENGINE_PROFILE_SCOPE("update");
+    previousStep = currentStep;
+    currentStep.angleX += 0.01f;
+    currentStep.angleY += 0.01f;
+    currentStep.angleZ += 0.01f;
+
+    currentStep.degree += 3;
+    if (currentStep.degree > 360) currentStep.degree = 0;
+
+    // Applied to the camera and the objects by the next capture().
+    animationPending = true;
+}
+
+// Poses the scene `alpha` of the way from the previous step to the current
+// one. Written as a * (1 - alpha) + b * alpha so alpha == 1 lands exactly on
+// the current step.
+void Renderer::applyAnimation(float alpha) {
+    const AnimationState& a = previousStep;
+    const AnimationState& b = currentStep;
+    // The orbit wraps at 360 degrees, so blend across the wrap the short way.
+    float turn = b.degree - a.degree;
+    turn -= 360.0f * std::round(turn / 360.0f);
+    float degree = b.degree - turn * (1 - alpha);
+
+    float moveX = r * cos(degree * M_PI / 180.0f);
+    float moveY = r * sin(degree * M_PI / 180.0f);
+    camera.setShift(moveX, moveY);
+
+    float angleX = a.angleX * (1 - alpha) + b.angleX * alpha;
+    float angleY = a.angleY * (1 - alpha) + b.angleY * alpha;
+    float angleZ = a.angleZ * (1 - alpha) + b.angleZ * alpha;
+    for (Object* object : objects) {
+        object->rotate(angleX, angleY, angleZ);
+    }
+    animationPending = false;
+    appliedAlpha = alpha;
+}
+
+// Screen rectangle and nearest depth of a world-space bounding sphere, from the
+// eight corners of its enclosing cube. Fails when the cube reaches behind the eye.
+static bool ProjectBounds(const mat4& viewProjection, const BoundingSphere& sphere, int width, int height, ScreenRect& rect, float& nearestDepth) {
+    float minX = HUGE_VALF, minY = HUGE_VALF, maxX = -HUGE_VALF, maxY = -HUGE_VALF;
+    float radius = sphere.radius;
+    nearestDepth = HUGE_VALF;
+    for (int corner = 0; corner < 8; ++corner) {
+        vec3d p = sphere.center + vec3d(corner & 1 ? radius : -radius, corner & 2 ? radius : -radius, corner & 4 ? radius : -radius);
+        vec4 clip = viewProjection.transformPoint(p);
+        if (!(clip.w > 0)) {
+            // Sorts first, and never counts as hidden.
+            nearestDepth = -HUGE_VALF;
+            return false;
+        }
+        vec3d screen = clip.project();
+        minX = std::min(minX, screen.x); maxX = std::max(maxX, screen.x);
+        minY = std::min(minY, screen.y); maxY = std::max(maxY, screen.y);
+        nearestDepth = std::min(nearestDepth, screen.z);
+    }
+    // Clamped just outside the screen so the casts below cannot overflow.
+    rect.left = (int)std::floor(std::max(minX, -1.0f));
+    rect.top = (int)std::floor(std::max(minY, -1.0f));
+    rect.right = (int)std::ceil(std::min(maxX, (float)width)) + 1;
+    rect.bottom = (int)std::ceil(std::min(maxY, (float)height)) + 1;
+    return true;
+}
+
+void Renderer::capture(FrameSnapshot& snapshot, float alpha) {
+    ENGINE_PROFILE_SCOPE("capture");
+    if (animationPending || alpha != appliedAlpha) {
+        applyAnimation(alpha);
+    }
+    snapshot.camera = camera;
+    snapshot.objects.resize(objects.size());
+    for (size_t i = 0; i < objects.size(); ++i) {
+        FrameSnapshot::ObjectState& state = snapshot.objects[i];
+        state.mesh = &objects[i]->getMesh();
+        state.transform = objects[i]->getTransform();
+        state.worldBounds = objects[i]->getWorldBounds();
+        state.cullMode = objects[i]->getCullMode();
+    }
+}
+
+void Renderer::render(float alpha) {
+    capture(ownSnapshot, alpha);
+    render(ownSnapshot);
+}
+
+void Renderer::render(const FrameSnapshot& snapshot) {
+    ENGINE_PROFILE_SCOPE("render");
+    frame = &snapshot;
+    size_t objectCount = snapshot.objects.size();
+    screenVertices.resize(objectCount);
+    modelViewProjection.resize(objectCount);
+    bounds.resize(objectCount);
+    visibleTriangles.resize(objectCount);
+    clipW.resize(objectCount);
+    history.resize(objectCount);
+    stats = RenderStats();
+    std::fill(tileDirty.begin(), tileDirty.end(), fullRedraw ? 1 : 0);
+    fullRedraw = false;
+
+    mat4 viewProjection = snapshot.camera.getViewProjection();
+    Frustum frustum = snapshot.camera.getFrustum();
+    drawOrder.clear();
+    for (size_t i = 0; i < objectCount; ++i) {
+        const BoundingSphere& sphere = snapshot.objects[i].worldBounds;
+        FrustumTest visibility = frustum.test(sphere);
+        ObjectHistory& last = history[i];
+        if (visibility == FrustumTest::Outside) {
+            ++stats.frustumCulledObjects;
+            if (last.onScreen) markDirty(last.rect);
+            last.onScreen = false;
+            continue;
+        }
+
+        modelViewProjection[i] = viewProjection * snapshot.objects[i].transform;
+        ObjectBounds& b = bounds[i];
+        b.valid = ProjectBounds(viewProjection, sphere, WIDTH, HEIGHT, b.rect, b.nearestDepth);
+        b.inside = visibility == FrustumTest::Inside;
+        // Bounds that reach behind the eye say nothing about the screen area.
+        if (!b.valid) b.rect = framebuffer.getBounds();
+        drawOrder.push_back(i);
+
+        if (!last.onScreen || !(last.modelViewProjection == modelViewProjection[i])) {
+            if (last.onScreen) markDirty(last.rect);
+            markDirty(b.rect);
+            last.modelViewProjection = modelViewProjection[i];
+            last.rect = b.rect;
+            last.onScreen = true;
+        }
+    }
+
+    // Unchanged objects only need drawing on tiles something else dirtied.
+    size_t onScreen = drawOrder.size();
+    drawOrder.erase(std::remove_if(drawOrder.begin(), drawOrder.end(), [this](size_t i) {
+        return !touchesDirtyTile(bounds[i].rect);
+    }), drawOrder.end());
+    stats.unchangedObjects = onScreen - drawOrder.size();
+    buildDirtyRegions();
+    stats.dirtyTiles = dirtyTiles.size();
+    stats.dirtyRegions = dirtyRegions.size();
+
+    // The first pass draws the front layer: objects whose bounds overlap no
+    // nearer object's bounds, so nothing else in the scene can hide them. The
+    // rest are queried against the coarse depth that pass leaves behind, and
+    // only the survivors are transformed and drawn in a second pass. Without a
+    // depth buffer (wireframe) everything is drawn in the first pass.
+    std::sort(drawOrder.begin(), drawOrder.end(), [this](size_t a, size_t b) {
+        return bounds[a].nearestDepth < bounds[b].nearestDepth;
+    });
+
+    frontLayer.clear();
+    occlusionCandidates.clear();
+    for (size_t n = 0; n < drawOrder.size(); ++n) {
+        size_t i = drawOrder[n];
+        bool overlapped = false;
+        if (fillMode == FillMode::Solid && bounds[i].valid) {
+            for (size_t m = 0; m < n && !overlapped; ++m) {
+                const ObjectBounds& nearer = bounds[drawOrder[m]];
+                overlapped = !nearer.valid || (nearer.rect.left < bounds[i].rect.right && bounds[i].rect.left < nearer.rect.right &&
+                    nearer.rect.top < bounds[i].rect.bottom && bounds[i].rect.top < nearer.rect.bottom);
+            }
+        }
+        (overlapped ? occlusionCandidates : frontLayer).push_back(i);
+    }
+
+    activeChunks = 0;
+    activeEdgeChunks = 0;
+    uint8_t clearedPlanes = fillMode == FillMode::Solid ? ColorCleared | DepthCleared : ColorCleared;
+    for (int tile : dirtyTiles) {
+        stats.fastClearedTiles += (tileCleared[tile] & clearedPlanes) == clearedPlanes;
+    }
+    runPass(frontLayer, true);
+
+    visibleCandidates.clear();
+    for (size_t i : occlusionCandidates) {
+        if (framebuffer.isOccluded(bounds[i].rect, bounds[i].nearestDepth)) {
+            ++stats.occludedObjects;
+        } else {
+            visibleCandidates.push_back(i);
+        }
+    }
+    if (!visibleCandidates.empty()) {
+        runPass(visibleCandidates, false);
+    }
+    if (samples && fillMode == FillMode::Solid) {
+        stats.expandedPixels = samples->getExpandedPixelCount();
+    }
+    frame = nullptr;
+}
+
+void Renderer::runPass(const std::vector<size_t>& passObjects, bool clearTiles) {
+    ENGINE_PROFILE_SCOPE("pass");
+    const int tileCount = tilesX * tilesY;
+    frameGraph.clear();
+    vertexChunks.clear();
+    passChunkBegin = activeChunks;
+    passEdgeChunkBegin = activeEdgeChunks;
+    const bool wireframe = fillMode == FillMode::Wireframe;
+
+    for (size_t i : passObjects) {
+        const Mesh& mesh = *frame->objects[i].mesh;
+        size_t vertexCount = mesh.vertices.size();
+        if (screenVertices[i].size() != vertexCount) {
+            screenVertices[i].resize(vertexCount);
+        }
+        if (!bounds[i].inside && clipW[i].size() != screenVertices[i].getPaddedSize()) {
+            clipW[i].allocate(screenVertices[i].getPaddedSize());
+        }
+        for (size_t begin = 0; begin < vertexCount; begin += VertexGrain) {
+            vertexChunks.push_back(VertexChunk{ i, begin, std::min(vertexCount, begin + VertexGrain) });
+        }
+
+        size_t triangleCount = mesh.getTriangleCount();
+        for (size_t begin = 0; begin < triangleCount; begin += BinningGrain) {
+            if (activeChunks == chunks.size()) {
+                chunks.emplace_back();
+            }
+            TriangleChunk& chunk = chunks[activeChunks++];
+            chunk.object = i;
+            chunk.begin = begin;
+            chunk.end = std::min(triangleCount, begin + BinningGrain);
+            chunk.bins.resize(tileCount);
+        }
+
+        if (wireframe) {
+            visibleTriangles[i].resize(triangleCount);
+            size_t edgeCount = mesh.getEdges().size();
+            for (size_t begin = 0; begin < edgeCount; begin += EdgeGrain) {
+                if (activeEdgeChunks == edgeChunks.size()) {
+                    edgeChunks.emplace_back();
+                }
+                EdgeChunk& chunk = edgeChunks[activeEdgeChunks++];
+                chunk.object = i;
+                chunk.begin = begin;
+                chunk.end = std::min(edgeCount, begin + EdgeGrain);
+                chunk.bins.resize(tileCount);
+            }
+        }
+
+        stats.projectedVertices += vertexCount;
+        stats.triangleCorners += triangleCount * 3;
+    }
+
+    // Binning reads any vertex of its object, so each object's triangle chunks
+    // wait on all of that object's vertex chunks.
+    verticesDone.resize(frame->objects.size());
+    for (size_t i : passObjects) {
+        verticesDone[i] = frameGraph.add([]() {});
+    }
+    for (const VertexChunk& chunk : vertexChunks) {
+        const VertexChunk* job = &chunk;
+        JobGraph::JobId projectJob = frameGraph.add([this, job]() { projectVertices(*job); });
+        frameGraph.addDependency(projectJob, verticesDone[chunk.object]);
+    }
+
+    JobGraph::JobId binningDone = frameGraph.add([]() {});
+    // Edges read the visibility of triangles from any chunk of their object.
+    setupDone.resize(frame->objects.size());
+    if (wireframe) {
+        for (size_t i : passObjects) {
+            setupDone[i] = frameGraph.add([]() {});
+        }
+    }
+    for (size_t c = passChunkBegin; c < activeChunks; ++c) {
+        TriangleChunk* chunk = &chunks[c];
+        JobGraph::JobId binJob = frameGraph.add([this, chunk]() { binTriangles(*chunk); });
+        frameGraph.addDependency(verticesDone[chunk->object], binJob);
+        frameGraph.addDependency(binJob, wireframe ? setupDone[chunk->object] : binningDone);
+    }
+    for (size_t c = passEdgeChunkBegin; c < activeEdgeChunks; ++c) {
+        EdgeChunk* chunk = &edgeChunks[c];
+        JobGraph::JobId edgeJob = frameGraph.add([this, chunk]() { binEdges(*chunk); });
+        frameGraph.addDependency(setupDone[chunk->object], edgeJob);
+        frameGraph.addDependency(edgeJob, binningDone);
+    }
+
+    for (int tile : dirtyTiles) {
+        JobGraph::JobId rasterJob = frameGraph.add([this, tile, clearTiles]() { rasterizeTile(tile, clearTiles); });
+        frameGraph.addDependency(binningDone, rasterJob);
+    }
+
+    frameGraph.run(pool);
+
+    for (size_t c = passChunkBegin; c < activeChunks; ++c) {
+        stats.setupTriangles += chunks[c].end - chunks[c].begin;
+        stats.culledBackFacing += chunks[c].culledBackFacing;
+        stats.culledSmall += chunks[c].culledSmall;
+        stats.clippedTriangles += chunks[c].clippedTriangles;
+        stats.binnedEntries += chunks[c].binnedEntries;
+    }
+    for (size_t c = passEdgeChunkBegin; c < activeEdgeChunks; ++c) {
+        stats.wireframeEdges += edgeChunks[c].drawnEdges;
+    }
+}
+
+void Renderer::projectVertices(const VertexChunk& chunk) {
+    ENGINE_PROFILE_SCOPE("project vertices");
+    const VertexStreams& rest = frame->objects[chunk.object].mesh->vertices;
+    VertexStreams& screen = screenVertices[chunk.object];
+    // Only objects that straddle the frustum can have triangles to clip, so only they keep w.
+    float* w = bounds[chunk.object].inside ? nullptr : clipW[chunk.object].get() + chunk.begin;
+    size_t b = chunk.begin;
+    GetVertexKernels().transformProject(modelViewProjection[chunk.object].m,
+        rest.x.get() + b, rest.y.get() + b, rest.z.get() + b,
+        screen.x.get() + b, screen.y.get() + b, screen.z.get() + b, w, chunk.end - b);
+}
+
+namespace {
+// Affine distance in homogeneous screen space; the inside is where it is >= 0.
+struct ClipPlane {
+    float x, y, z, w, constant;
+
+    float distance(const vec4& v) const { return x * v.x + y * v.y + z * v.z + w * v.w + constant; }
+};
+}
+
+// Sutherland-Hodgman against each plane in turn. polygon holds count vertices
+// on entry and the clipped polygon on return; both buffers need room for
+// count + planeCount vertices.
+static int ClipPolygon(vec4* polygon, vec4* scratch, int count, const ClipPlane* planes, int planeCount) {
+    for (int p = 0; p < planeCount && count > 0; ++p) {
+        const ClipPlane& plane = planes[p];
+        int outCount = 0;
+        vec4 previous = polygon[count - 1];
+        float previousDistance = plane.distance(previous);
+        for (int i = 0; i < count; ++i) {
+            vec4 current = polygon[i];
+            float currentDistance = plane.distance(current);
+            if ((previousDistance >= 0) != (currentDistance >= 0)) {
+                float t = previousDistance / (previousDistance - currentDistance);
+                scratch[outCount++] = vec4(previous.x + (current.x - previous.x) * t, previous.y + (current.y - previous.y) * t,
+                    previous.z + (current.z - previous.z) * t, previous.w + (current.w - previous.w) * t);
+            }
+            if (currentDistance >= 0) {
+                scratch[outCount++] = current;
+            }
+            previous = current;
+            previousDistance = currentDistance;
+        }
+        std::copy(scratch, scratch + outCount, polygon);
+        count = outCount;
+    }
+    return count;
+}
+
+void Renderer::binTriangles(TriangleChunk& chunk) {
+    ENGINE_PROFILE_SCOPE("bin triangles");
+    const Mesh& mesh = *frame->objects[chunk.object].mesh;
+    const VertexStreams& screen = screenVertices[chunk.object];
+    const float* sx = screen.x.get();
+    const float* sy = screen.y.get();
+    const float* sz = screen.z.get();
+    for (auto& bin : chunk.bins) {
+        bin.clear();
+    }
+    chunk.clipped.clear();
+    chunk.culledBackFacing = 0;
+    chunk.culledSmall = 0;
+    chunk.clippedTriangles = 0;
+    chunk.binnedEntries = 0;
+
+    CullMode cullMode = frame->objects[chunk.object].cullMode;
+    bool inside = bounds[chunk.object].inside;
+    const float* w = inside ? nullptr : clipW[chunk.object].get();
+    // Wireframe draws mesh edges, so setup only records which triangles survive.
+    uint8_t* visible = fillMode == FillMode::Wireframe ? visibleTriangles[chunk.object].data() : nullptr;
+    const float nearW = frame->camera.getNearDistance();
+    const float guardLeft = -GuardBand, guardTop = -GuardBand;
+    const float guardRight = WIDTH + GuardBand, guardBottom = HEIGHT + GuardBand;
+
+    for (size_t t = chunk.begin; t < chunk.end; ++t) {
+        uint32_t a, b, c;
+        mesh.getTriangle(t, a, b, c);
+        vec3d p0(sx[a], sy[a], sz[a]), p1(sx[b], sy[b], sz[b]), p2(sx[c], sy[c], sz[c]);
+
+        // Triangles that reach behind the near plane or past the guard band are
+        // clipped in homogeneous space. Everything else is within range for the
+        // rasterizer, which only ever walks its clip rect.
+        if (w) {
+            bool inFront = w[a] >= nearW && w[b] >= nearW && w[c] >= nearW;
+            if (!inFront || !(std::min({ p0.x, p1.x, p2.x }) >= guardLeft && std::max({ p0.x, p1.x, p2.x }) <= guardRight &&
+                              std::min({ p0.y, p1.y, p2.y }) >= guardTop && std::max({ p0.y, p1.y, p2.y }) <= guardBottom)) {
+                ++chunk.clippedTriangles;
+                // The cached screen positions are unusable here, so the pieces
+                // are drawn as triangles and the mesh edges skip this one.
+                clipTriangle(chunk, a, b, c, cullMode);
+                if (visible) visible[t] = 0;
+                continue;
+            }
+        }
+
+        bool kept = setupTriangle(chunk, p0, p1, p2, (uint32_t)t, cullMode, inside, !visible);
+        if (visible) visible[t] = kept;
+    }
+}
+
+void Renderer::clipTriangle(TriangleChunk& chunk, uint32_t a, uint32_t b, uint32_t c, CullMode cullMode) {
+    const ClipPlane planes[] = {
+        { 0, 0, 0, 1, -frame->camera.getNearDistance() },
+        { 1, 0, 0, GuardBand, 0 },
+        { -1, 0, 0, WIDTH + GuardBand, 0 },
+        { 0, 1, 0, GuardBand, 0 },
+        { 0, -1, 0, HEIGHT + GuardBand, 0 },
+    };
+    const int planeCount = sizeof(planes) / sizeof(planes[0]);
+
+    // The screen cache has already divided by w, so start again from the rest pose.
+    const Mesh& mesh = *frame->objects[chunk.object].mesh;
+    const mat4& mvp = modelViewProjection[chunk.object];
+    vec4 polygon[3 + planeCount], scratch[3 + planeCount];
+    polygon[0] = mvp.transformPoint(mesh.getVertex(a));
+    polygon[1] = mvp.transformPoint(mesh.getVertex(b));
+    polygon[2] = mvp.transformPoint(mesh.getVertex(c));
+    int count = ClipPolygon(polygon, scratch, 3, planes, planeCount);
+
+    // Fan out the convex result; winding is preserved, so culling still applies.
+    for (int i = 1; i + 1 < count; ++i) {
+        triangle fan(polygon[0].project(), polygon[i].project(), polygon[i + 1].project());
+        uint32_t entry = ClippedEntry | (uint32_t)chunk.clipped.size();
+        if (setupTriangle(chunk, fan.p1, fan.p2, fan.p3, entry, cullMode, false, true)) {
+            chunk.clipped.push_back(fan);
+        }
+    }
+}
+
+bool Renderer::setupTriangle(TriangleChunk& chunk, const vec3d& p0, const vec3d& p1, const vec3d& p2, uint32_t entry, CullMode cullMode, bool inside, bool bin) {
+    float minX = std::min({ p0.x, p1.x, p2.x });
+    float maxX = std::max({ p0.x, p1.x, p2.x });
+    float minY = std::min({ p0.y, p1.y, p2.y });
+    float maxY = std::max({ p0.y, p1.y, p2.y });
+    // Written this way round so NaN coordinates are rejected as well. Objects
+    // entirely inside the frustum cannot produce such triangles.
+    if (!inside && !(maxX >= 0 && maxY >= 0 && minX < WIDTH && minY < HEIGHT)) return false;
+
+    // Zero area, or a bounding box that holds no pixel centre in x or y:
+    // the fill rule could never produce a pixel from it. Samples lie within
+    // half a pixel of the centres.
+    float area = (p1.x - p0.x) * (p2.y - p0.y) - (p1.y - p0.y) * (p2.x - p0.x);
+    float reach = samples && fillMode == FillMode::Solid ? 0.5f : 0.0f;
+    if (area == 0 || std::ceil(minX - 0.5f - reach) > std::floor(maxX - 0.5f + reach) || std::ceil(minY - 0.5f - reach) > std::floor(maxY - 0.5f + reach)) {
+        ++chunk.culledSmall;
+        return false;
+    }
+    // Clockwise on screen (y down) is positive area, i.e. back-facing.
+    if ((cullMode == CullMode::Back && area > 0) || (cullMode == CullMode::Front && area < 0)) {
+        ++chunk.culledBackFacing;
+        return false;
+    }
+    if (!bin) return true;
+
+    // Anti-aliased outlines reach up to a pixel past the truncated bounds.
+    float pad = fillMode == FillMode::Wireframe && lineAntialiasing ? 1.0f : 0.0f;
+    int tileX0 = std::max(0, (int)(minX - pad)) / tileSize;
+    int tileY0 = std::max(0, (int)(minY - pad)) / tileSize;
+    int tileX1 = std::min(WIDTH - 1, (int)(maxX + pad)) / tileSize;
+    int tileY1 = std::min(HEIGHT - 1, (int)(maxY + pad)) / tileSize;
+    for (int ty = tileY0; ty <= tileY1; ++ty) {
+        for (int tx = tileX0; tx <= tileX1; ++tx) {
+            int tile = ty * tilesX + tx;
+            if (!tileDirty[tile]) continue;
+            chunk.bins[tile].push_back(entry);
+            ++chunk.binnedEntries;
+        }
+    }
+    return true;
+}
+
+void Renderer::binEdges(EdgeChunk& chunk) {
+    ENGINE_PROFILE_SCOPE("bin edges");
+    const std::vector<MeshEdge>& edges = frame->objects[chunk.object].mesh->getEdges();
+    const VertexStreams& screen = screenVertices[chunk.object];
+    const uint8_t* visible = visibleTriangles[chunk.object].data();
+    for (auto& bin : chunk.bins) {
+        bin.clear();
+    }
+    chunk.drawnEdges = 0;
+
+    for (size_t e = chunk.begin; e < chunk.end; ++e) {
+        const MeshEdge& edge = edges[e];
+        if (!visible[edge.triangle0] && !(edge.triangle1 != MeshEdge::NoTriangle && visible[edge.triangle1])) continue;
+
+        // DrawLine takes truncated endpoints, so bin by those; anti-aliased
+        // lines cover up to one more pixel on each side.
+        int x0 = (int)screen.x[edge.a], y0 = (int)screen.y[edge.a];
+        int x1 = (int)screen.x[edge.b], y1 = (int)screen.y[edge.b];
+        int pad = lineAntialiasing ? 1 : 0;
+        int minX = std::max(0, std::min(x0, x1) - pad), maxX = std::min(WIDTH - 1, std::max(x0, x1) + pad);
+        int minY = std::max(0, std::min(y0, y1) - pad), maxY = std::min(HEIGHT - 1, std::max(y0, y1) + pad);
+        if (minX > maxX || minY > maxY) continue;
+
+        ++chunk.drawnEdges;
+        for (int ty = minY / tileSize; ty <= maxY / tileSize; ++ty) {
+            for (int tx = minX / tileSize; tx <= maxX / tileSize; ++tx) {
+                int tile = ty * tilesX + tx;
+                if (tileDirty[tile]) chunk.bins[tile].push_back((uint32_t)e);
+            }
+        }
+    }
+}
+
+void Renderer::rasterizeTile(int tile, bool clear) {
+    ENGINE_PROFILE_SCOPE("rasterize tile");
+    ScreenRect rect = getTileRect(tile);
+    bool hasWork = false;
+    for (size_t c = passChunkBegin; c < activeChunks && !hasWork; ++c) {
+        hasWork = !chunks[c].bins[tile].empty();
+    }
+    for (size_t c = passEdgeChunkBegin; c < activeEdgeChunks && !hasWork; ++c) {
+        hasWork = !edgeChunks[c].bins[tile].empty();
+    }
+
+    uint8_t& cleared = tileCleared[tile];
+    if (clear) {
+        Framebuffer::Store store = hasWork ? Framebuffer::Store::Cached : Framebuffer::Store::Streaming;
+        if (!(cleared & ColorCleared)) {
+            framebuffer.fill(rect, MakeColor(255, 255, 255), store);
+            cleared |= ColorCleared;
+        }
+        if (fillMode == FillMode::Solid && !(cleared & DepthCleared)) {
+            framebuffer.fillDepth(rect, Framebuffer::FarDepth, store);
+            cleared |= DepthCleared;
+        }
+        if (samples) {
+            samples->clearTile(tile);
+        }
+    }
+    if (!hasWork) return;
+    // Wireframe never writes depth. A binned entry may still draw nothing, so this errs towards clearing.
+    cleared &= fillMode == FillMode::Wireframe ? DepthCleared : 0;
+    SampleBuffer* tileSamples = fillMode == FillMode::Solid ? samples.get() : nullptr;
+
+    for (size_t c = passChunkBegin; c < activeChunks; ++c) {
+        const TriangleChunk& chunk = chunks[c];
+        const Mesh& mesh = *frame->objects[chunk.object].mesh;
+        const VertexStreams& screen = screenVertices[chunk.object];
+        for (uint32_t entry : chunk.bins[tile]) {
+            vec3d p1, p2, p3;
+            if (entry & ClippedEntry) {
+                const triangle& clipped = chunk.clipped[entry & ~ClippedEntry];
+                p1 = clipped.p1; p2 = clipped.p2; p3 = clipped.p3;
+            } else {
+                uint32_t i0, i1, i2;
+                mesh.getTriangle(entry, i0, i1, i2);
+                p1 = vec3d(screen.x[i0], screen.y[i0], screen.z[i0]);
+                p2 = vec3d(screen.x[i1], screen.y[i1], screen.z[i1]);
+                p3 = vec3d(screen.x[i2], screen.y[i2], screen.z[i2]);
+            }
+            if (tileSamples) {
+                FillTriangle(framebuffer, *tileSamples, p1, p2, p3, MakeColor(0, 0, 255), rect);
+            } else if (fillMode == FillMode::Solid) {
+                FillTriangle(framebuffer, p1, p2, p3, MakeColor(0, 0, 255), rect);
+            } else if (lineAntialiasing) {
+                DrawTriangleAA(framebuffer, p1, p2, p3, MakeColor(0, 0, 255), rect);
+            } else {
+                DrawTriangle(framebuffer, p1, p2, p3, MakeColor(0, 0, 255), rect);
+            }
+        }
+    }
+
+    for (size_t c = passEdgeChunkBegin; c < activeEdgeChunks; ++c) {
+        const EdgeChunk& chunk = edgeChunks[c];
+        const std::vector<MeshEdge>& edges = frame->objects[chunk.object].mesh->getEdges();
+        const VertexStreams& screen = screenVertices[chunk.object];
+        for (uint32_t e : chunk.bins[tile]) {
+            const MeshEdge& edge = edges[e];
+            if (lineAntialiasing) {
+                DrawLineAA(framebuffer, screen.x[edge.a], screen.y[edge.a], screen.x[edge.b], screen.y[edge.b], MakeColor(0, 0, 255), rect);
+            } else {
+                DrawLine(framebuffer, (int)screen.x[edge.a], (int)screen.y[edge.a], (int)screen.x[edge.b], (int)screen.y[edge.b], MakeColor(0, 0, 255), rect);
+            }
+        }
+    }
+
+    if (tileSamples) {
+        tileSamples->resolveTile(framebuffer, tile);
+    }
+}
+
+ScreenRect Renderer::getTileRect(int tile) const {
+    int x = (tile % tilesX) * tileSize;
+    int y = (tile / tilesX) * tileSize;
+    return ScreenRect{ x, y, std::min(x + tileSize, WIDTH), std::min(y + tileSize, HEIGHT) };
+}
+
+ScreenRect Renderer::getTileRange(const ScreenRect& rect) const {
+    int left = std::max(rect.left, 0), top = std::max(rect.top, 0);
+    int right = std::min(rect.right, WIDTH), bottom = std::min(rect.bottom, HEIGHT);
+    if (left >= right || top >= bottom) return ScreenRect{ 0, 0, 0, 0 };
+    return ScreenRect{ left / tileSize, top / tileSize, (right + tileSize - 1) / tileSize, (bottom + tileSize - 1) / tileSize };
+}
+
+void Renderer::markDirty(const ScreenRect& rect) {
+    ScreenRect range = getTileRange(rect);
+    for (int ty = range.top; ty < range.bottom; ++ty) {
+        std::fill(tileDirty.begin() + ty * tilesX + range.left, tileDirty.begin() + ty * tilesX + range.right, 1);
+    }
+}
+
+bool Renderer::touchesDirtyTile(const ScreenRect& rect) const {
+    ScreenRect range = getTileRange(rect);
+    for (int ty = range.top; ty < range.bottom; ++ty) {
+        for (int tx = range.left; tx < range.right; ++tx) {
+            if (tileDirty[ty * tilesX + tx]) return true;
+        }
+    }
+    return false;
+}
+
+// Lists the dirty tiles and covers them with rectangles: one per horizontal
+// run of dirty tiles, grown downwards while the next row repeats the run.
+void Renderer::buildDirtyRegions() {
+    dirtyTiles.clear();
+    dirtyRegions.clear();
+    for (int ty = 0; ty < tilesY; ++ty) {
+        for (int tx = 0; tx < tilesX;) {
+            if (!tileDirty[ty * tilesX + tx]) {
+                ++tx;
+                continue;
+            }
+            int first = tx;
+            for (; tx < tilesX && tileDirty[ty * tilesX + tx]; ++tx) {
+                dirtyTiles.push_back(ty * tilesX + tx);
+            }
+            ScreenRect run = getTileRect(ty * tilesX + first);
+            run.right = std::min(tx * tileSize, WIDTH);
+            bool merged = false;
+            for (ScreenRect& above : dirtyRegions) {
+                if (above.bottom == run.top && above.left == run.left && above.right == run.right) {
+                    above.bottom = run.bottom;
+                    merged = true;
+                    break;
+                }
+            }
+            if (!merged) dirtyRegions.push_back(run);
+        }
+    }
+}
+
+void Renderer::present(Presenter& presenter) const {
+    ENGINE_PROFILE_SCOPE("present");
+    presenter.presentRegions(framebuffer, dirtyRegions);
+}
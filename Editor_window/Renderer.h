@@ -0,0 +1,293 @@
+#pragma once
+#include <cstdint>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include "Camera.h"
+#include "Framebuffer.h"
+#include "Geometry.h"
+#include "JobGraph.h"
+#include "Presenter.h"
+#include "SampleBuffer.h"
+#include "ThreadPool.h"
+
+// Platform-free half of the engine: owns the scene, advances the animation and
+// rasterizes frames into its framebuffer. Window backends drive it from their
+// message loop; headless tools drive it directly.
+//
+// Each render() runs a frame graph on the engine's ThreadPool:
+//   project (per vertex chunk) -> bin (per triangle chunk) -> rasterize (per screen tile)
+// Wireframe frames bin mesh edges instead: triangle setup only records which
+// triangles survive culling, and each unique edge next to a surviving triangle
+// is binned and drawn once.
+//
+// Objects whose bounding sphere lies outside the camera frustum are dropped
+// before any per-vertex work. Solid frames run that graph twice: once for the unobstructed front layer and
+// once for whatever the coarse depth it leaves cannot prove hidden. Objects it
+// can are skipped before any of their vertices are transformed.
+// Projection applies one concatenated model-view-projection matrix per vertex,
+// straight from each object's rest pose, into a per-object screen-space vertex
+// cache. Binning and rasterization index that cache, so a vertex shared by six
+// triangles is still projected once. Tiles own disjoint framebuffer regions,
+// so rasterization needs no locking. At the default 64x64 a tile's color and
+// depth take 32 KiB, small enough to stay in L1/L2 while its bins are drawn,
+// and a 1080p frame splits into enough tiles to keep every core busy.
+//
+// Clears are per tile and lazy: a tile remembers which planes nothing has
+// been drawn into since its last clear and skips clearing those again, so an
+// empty stretch of screen costs no memory traffic frame after frame. Tiles
+// that get nothing to draw are cleared with streaming stores, since only the
+// presenter reads them back.
+//
+// Only tiles whose content can have changed are rendered at all. Each object's
+// model-view-projection and screen bounds are kept from the frame that last
+// drew it; when either changes, its old and new bounds mark tiles dirty.
+// Raster jobs run for dirty tiles only, objects whose bounds miss every dirty
+// tile are not even projected, and getDirtyRegions() lists the rectangles a
+// presenter has to update. Anything that changes how the whole frame looks
+// dirties every tile.
+//
+// The scene side (update(), capture(), the camera and the objects) and the
+// render side (render(snapshot), present() and the render settings) share no
+// state: capture() copies what a frame needs into a FrameSnapshot, and
+// render() reads only that and the immutable meshes. A FramePipeline runs the
+// two sides on different threads so the next frame is simulated while the
+// current one is drawn.
+
+// Per-frame counters, filled by render().
+struct RenderStats {
+    size_t projectedVertices = 0;
+    // Vertices a per-triangle pipeline would have projected (3 per triangle).
+    size_t triangleCorners = 0;
+    // Objects skipped by the frustum test and by the coarse depth query.
+    size_t frustumCulledObjects = 0;
+    size_t occludedObjects = 0;
+    // Triangle setup: triangles of drawn objects, and those it discarded.
+    size_t setupTriangles = 0;
+    size_t culledBackFacing = 0;
+    size_t culledSmall = 0;
+    // Triangles that crossed the near plane or the guard band and went through the clipper.
+    size_t clippedTriangles = 0;
+    // Tiles rendered this frame, and objects left alone because nothing
+    // changed on the tiles they cover.
+    size_t dirtyTiles = 0;
+    size_t dirtyRegions = 0;
+    size_t unchangedObjects = 0;
+    // Tiles whose clear was skipped because they still held the last one.
+    size_t fastClearedTiles = 0;
+    // Triangle-tile pairs binned; above the drawn triangle count by however
+    // many triangles straddle tile borders.
+    size_t binnedEntries = 0;
+    // Wireframe: unique edges drawn, next to triangleCorners' one line per corner.
+    size_t wireframeEdges = 0;
+    // Multisampling: pixels that needed per-sample storage by the end of the frame.
+    size_t expandedPixels = 0;
+};
+
+// The scene as one frame sees it, copied by Renderer::capture(). Meshes are
+// immutable and referenced, not copied.
+struct FrameSnapshot {
+    struct ObjectState {
+        const Mesh* mesh;
+        mat4 transform;
+        BoundingSphere worldBounds;
+        CullMode cullMode;
+    };
+    Camera camera;
+    std::vector<ObjectState> objects;
+};
+
+enum class FillMode {
+    Wireframe,
+    Solid,
+};
+
+class Renderer {
+public:
+    static constexpr int DefaultTileSize = 64;
+    // Keeps a tile's pixels addressable by SampleBuffer's 16-bit slots.
+    static constexpr int MaxTileSize = 128;
+    static bool isValidTileSize(int size) { return size > 0 && size <= MaxTileSize && size % Framebuffer::CoarseBlockSize == 0; }
+    static bool isValidSampleCount(int count) { return count == 1 || count == 4 || count == 8; }
+
+    // workerCount and pinThreads configure the engine's persistent ThreadPool.
+    Renderer(int width, int height, unsigned workerCount = ThreadPool::AutoWorkerCount, bool pinThreads = false);
+
+    void addObject(Object* obj);
+    // fieldOfView * scale is the focal length of the perspective mapping. The
+    // camera is placed one focal length in front of the world origin.
+    void setProjection(float fieldOfView, float aspectRatio, float scale);
+    Camera& getCamera() { return camera; }
+    const Camera& getCamera() const { return camera; }
+    void setFillMode(FillMode mode) {
+        if (mode != fillMode) invalidate();
+        fillMode = mode;
+    }
+    FillMode getFillMode() const { return fillMode; }
+    // Wireframe only: blend lines by coverage instead of drawing aliased pixels.
+    void setLineAntialiasing(bool enabled) {
+        if (enabled != lineAntialiasing) invalidate();
+        lineAntialiasing = enabled;
+    }
+    bool getLineAntialiasing() const { return lineAntialiasing; }
+    // Solid only: 4 or 8 samples per pixel, resolved per tile; 1 turns it off.
+    // Ignored unless isValidSampleCount().
+    void setMultisampling(int sampleCount);
+    int getMultisampling() const { return samples ? samples->getSampleCount() : 1; }
+    // Edge length of the square screen tiles rasterized as independent jobs;
+    // ignored unless isValidTileSize(). Tiles never split a coarse depth block.
+    void setTileSize(int size);
+    int getTileSize() const { return tileSize; }
+
+    // Length of one update() step; the animation is tuned for 60 steps a second.
+    static constexpr double SimulationStep = 1.0 / 60.0;
+
+    // Advances the animation by one fixed step.
+    void update();
+    // Draws the scene `alpha` (0..1) of the way from the previous update()
+    // step to the latest one, so frames between steps move smoothly.
+    void render(float alpha = 1.0f);
+    // The two halves of render(alpha): poses the scene and copies it into
+    // snapshot, then draws a snapshot. Scene changes made after capture() do
+    // not reach that frame, so the scene may move on while it is drawn.
+    void capture(FrameSnapshot& snapshot, float alpha = 1.0f);
+    void render(const FrameSnapshot& snapshot);
+    // Hands the presenter the regions the last render() changed, or the given ones.
+    void present(Presenter& presenter) const;
+    void present(Presenter& presenter, const std::vector<ScreenRect>& regions) const { presenter.presentRegions(framebuffer, regions); }
+    // Makes the next render() redraw every tile.
+    void invalidate() { fullRedraw = true; }
+    // Rectangles, on tile boundaries, that the last render() redrew.
+    const std::vector<ScreenRect>& getDirtyRegions() const { return dirtyRegions; }
+
+    // Writing through this drops the fast-clear state and redraws the next
+    // frame in full, since the renderer can no longer tell what the tiles hold.
+    Framebuffer& getFramebuffer() {
+        std::fill(tileCleared.begin(), tileCleared.end(), 0);
+        invalidate();
+        return framebuffer;
+    }
+    const Framebuffer& getFramebuffer() const { return framebuffer; }
+    int getWidth() const { return WIDTH; }
+    int getHeight() const { return HEIGHT; }
+    ThreadPool& getThreadPool() { return pool; }
+    const RenderStats& getStats() const { return stats; }
+
+private:
+    // A contiguous run of one object's vertices, projected by a single job.
+    struct VertexChunk {
+        size_t object;
+        size_t begin, end;
+    };
+
+    // A contiguous run of one object's triangles, set up and binned by a
+    // single job. bins[tile] lists the triangles of this run that touch that
+    // tile, so tile jobs read what binning produced without any shared append
+    // buffer. The cull counters are per chunk for the same reason.
+    //
+    // A bin entry is a mesh triangle index, or ClippedEntry | i for clipped[i],
+    // a screen-space piece of a triangle the clipper had to split.
+    static constexpr uint32_t ClippedEntry = 0x80000000u;
+    struct TriangleChunk {
+        size_t object;
+        size_t begin, end;
+        std::vector<std::vector<uint32_t>> bins;
+        std::vector<triangle> clipped;
+        size_t culledBackFacing, culledSmall, clippedTriangles, binnedEntries;
+    };
+
+    // A contiguous run of one object's mesh edges, binned by a single job.
+    struct EdgeChunk {
+        size_t object;
+        size_t begin, end;
+        std::vector<std::vector<uint32_t>> bins;
+        size_t drawnEdges;
+    };
+
+    // Screen-space bounds of an object's bounding sphere this frame; invalid
+    // when the sphere reaches behind the eye. inside is set when the sphere is
+    // entirely within the frustum, so its triangles need no screen rejection.
+    struct ObjectBounds {
+        ScreenRect rect;
+        float nearestDepth;
+        bool valid;
+        bool inside;
+    };
+
+    // What an object looked like on screen when tiles last drew it.
+    struct ObjectHistory {
+        mat4 modelViewProjection;
+        ScreenRect rect;
+        bool onScreen = false;
+    };
+
+    void applyAnimation(float alpha);
+    void runPass(const std::vector<size_t>& passObjects, bool clearTiles);
+    void projectVertices(const VertexChunk& chunk);
+    void binTriangles(TriangleChunk& chunk);
+    void binEdges(EdgeChunk& chunk);
+    void clipTriangle(TriangleChunk& chunk, uint32_t a, uint32_t b, uint32_t c, CullMode cullMode);
+    // Culls one screen-space triangle and, if `bin` is set, bins it under
+    // `entry`; returns whether it survived culling.
+    bool setupTriangle(TriangleChunk& chunk, const vec3d& p0, const vec3d& p1, const vec3d& p2, uint32_t entry, CullMode cullMode, bool inside, bool bin);
+    void rasterizeTile(int tile, bool clear);
+    ScreenRect getTileRect(int tile) const;
+    // Tile range covered by rect after clipping it to the screen; empty if none.
+    ScreenRect getTileRange(const ScreenRect& rect) const;
+    void markDirty(const ScreenRect& rect);
+    bool touchesDirtyTile(const ScreenRect& rect) const;
+    void buildDirtyRegions();
+
+    const int WIDTH;
+    const int HEIGHT;
+    // Animation at the last two update() steps; render() blends between them.
+    struct AnimationState {
+        float angleX = 0, angleY = 0, angleZ = 0;
+        float degree = 0;
+    };
+    AnimationState previousStep, currentStep;
+    float appliedAlpha = 1.0f;
+    bool animationPending = false;
+    int r;
+    FillMode fillMode = FillMode::Solid;
+    bool lineAntialiasing = false;
+    std::unique_ptr<SampleBuffer> samples;
+    int tileSize = DefaultTileSize;
+    int tilesX, tilesY;
+    // Per tile, the planes that still hold exactly what the last clear wrote.
+    enum : uint8_t { ColorCleared = 1, DepthCleared = 2 };
+    std::vector<uint8_t> tileCleared;
+    bool fullRedraw = true;
+    std::vector<uint8_t> tileDirty;
+    std::vector<int> dirtyTiles;
+    std::vector<ScreenRect> dirtyRegions;
+    std::vector<ObjectHistory> history;
+    Camera camera;
+    Framebuffer framebuffer;
+    std::vector<Object*> objects;
+    // The snapshot render(alpha) captures into, and the one being drawn.
+    FrameSnapshot ownSnapshot;
+    const FrameSnapshot* frame = nullptr;
+    // Screen-space vertex cache per object, refilled every render(); z keeps the projected depth.
+    std::vector<VertexStreams> screenVertices;
+    // Clip-space w per vertex, kept only for objects that straddle the frustum.
+    std::vector<AlignedBuffer<float, VertexStreams::Alignment>> clipW;
+    std::vector<mat4> modelViewProjection;
+    std::vector<VertexChunk> vertexChunks;
+    // Only the first activeChunks entries belong to the current frame; the rest keep their allocations.
+    std::vector<TriangleChunk> chunks;
+    size_t activeChunks = 0;
+    // First chunk of the pass being run; earlier chunks were drawn by the previous pass.
+    size_t passChunkBegin = 0;
+    std::vector<EdgeChunk> edgeChunks;
+    size_t activeEdgeChunks = 0;
+    size_t passEdgeChunkBegin = 0;
+    // Wireframe: per object, whether each triangle survived setup this frame.
+    std::vector<std::vector<uint8_t>> visibleTriangles;
+    std::vector<ObjectBounds> bounds;
+    std::vector<size_t> drawOrder, frontLayer, occlusionCandidates, visibleCandidates;
+    std::vector<JobGraph::JobId> verticesDone, setupDone;
+    RenderStats stats;
+    JobGraph frameGraph;
+    ThreadPool pool;
+};
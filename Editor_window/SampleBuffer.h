@@ -0,0 +1,156 @@
+#pragma once
+#include <cstdint>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include "AlignedBuffer.h"
+#include "Framebuffer.h"
+
+// Multisample storage that sits next to a Framebuffer. A pixel whose samples
+// all hold the same surface is stored once, in the framebuffer's own color and
+// depth planes (depth taken at the pixel centre); only pixels on a triangle
+// edge expand to one color and depth per sample. Expanded pixels take slots
+// from a pool owned by their tile, so tile jobs never share an allocator. A
+// pixel stays expanded until its tile is cleared, which rewinds the pool and
+// bounds it by the tile's pixel count. Interior pixels therefore cost the same
+// memory traffic as single-sampled rendering plus a 16-bit slot read.
+//
+// While a pixel is expanded, its depth-plane entry holds the farthest of its
+// sample depths, so the framebuffer's coarse depth stays a valid upper bound.
+class SampleBuffer {
+public:
+    static constexpr uint16_t Uniform = 0xFFFF;
+    static constexpr int MaxSamples = 8;
+
+    // Sample positions in 1/16 pixel relative to the pixel centre (the
+    // standard 4x and 8x patterns).
+    static const int8_t (*getPattern(int sampleCount))[2] {
+        static const int8_t pattern4[4][2] = { { -2, -6 }, { 6, -2 }, { -6, 2 }, { 2, 6 } };
+        static const int8_t pattern8[8][2] = { { 1, -3 }, { -1, 3 }, { 5, 1 }, { -3, -5 }, { -5, 5 }, { -7, -1 }, { 3, 7 }, { 7, -7 } };
+        return sampleCount == 8 ? pattern8 : pattern4;
+    }
+
+    // sampleCount is 4 or 8; tileSize must match the tiles that clear and
+    // resolve the buffer, and keep a tile's pixel count below Uniform.
+    SampleBuffer(int width, int height, int sampleCount, int tileSize)
+        : width(width), height(height), sampleCount(sampleCount == 8 ? 8 : 4), tileSize(tileSize) {
+        pitch = (width + Framebuffer::PixelsPerAlignment - 1) / Framebuffer::PixelsPerAlignment * Framebuffer::PixelsPerAlignment;
+        slots.allocate(size_t(pitch) * height);
+        std::fill(slots.get(), slots.get() + slots.size(), Uniform);
+        tilesX = (width + tileSize - 1) / tileSize;
+        tiles.resize(size_t(tilesX) * ((height + tileSize - 1) / tileSize));
+        blocksX = (width + BlockSize - 1) / BlockSize;
+        expandedBlocks.assign(size_t(blocksX) * ((height + BlockSize - 1) / BlockSize), 0);
+    }
+
+    int getSampleCount() const { return sampleCount; }
+
+    uint16_t getSlot(int x, int y) const { return slots[size_t(y) * pitch + x]; }
+    // Rows share the framebuffer's alignment, so 8-pixel blocks load with aligned 16-byte reads.
+    const uint16_t* getSlotRow(int y) const { return slots.get() + size_t(y) * pitch; }
+
+    // True when some pixel of the 8x8 block at (blockX, blockY) holds samples.
+    bool isBlockExpanded(int blockX, int blockY) const { return expandedBlocks[size_t(blockY) * blocksX + blockX] != 0; }
+
+    int getTile(int x, int y) const { return (y / tileSize) * tilesX + x / tileSize; }
+
+    // Gives pixel (x, y) of `tile` its own samples, all set to the given color
+    // and depth, and returns its slot.
+    uint16_t expand(int tile, int x, int y, uint32_t color, float depth) {
+        TilePool& pool = tiles[tile];
+        size_t first = size_t(pool.used) * sampleCount;
+        if (first + sampleCount > pool.colors.size()) {
+            pool.colors.resize(first + sampleCount);
+            pool.depths.resize(first + sampleCount);
+        }
+        std::fill(pool.colors.begin() + first, pool.colors.begin() + first + sampleCount, color);
+        std::fill(pool.depths.begin() + first, pool.depths.begin() + first + sampleCount, depth);
+        slots[size_t(y) * pitch + x] = pool.used;
+        expandedBlocks[size_t(y / BlockSize) * blocksX + x / BlockSize] = 1;
+        return pool.used++;
+    }
+
+    // Samples of an expanded pixel; valid until the tile's next expand().
+    uint32_t* getColors(int tile, uint16_t slot) { return tiles[tile].colors.data() + size_t(slot) * sampleCount; }
+    float* getDepths(int tile, uint16_t slot) { return tiles[tile].depths.data() + size_t(slot) * sampleCount; }
+
+    // Forgets every expanded pixel of the tile.
+    void clearTile(int tile) {
+        ScreenRect rect = getTileRect(tile);
+        forEachExpandedBlock(rect, [&](int bx, int by) {
+            int right = std::min(bx + BlockSize, width), bottom = std::min(by + BlockSize, height);
+            for (int y = by; y < bottom; ++y) {
+                std::fill(slots.get() + size_t(y) * pitch + bx, slots.get() + size_t(y) * pitch + right, Uniform);
+            }
+            expandedBlocks[size_t(by / BlockSize) * blocksX + bx / BlockSize] = 0;
+        });
+        tiles[tile].used = 0;
+    }
+
+    // Writes the average of each expanded pixel's samples to the color plane.
+    void resolveTile(Framebuffer& framebuffer, int tile) {
+        int shift = sampleCount == 8 ? 3 : 2;
+        ScreenRect rect = getTileRect(tile);
+        forEachExpandedBlock(rect, [&](int bx, int by) {
+            int right = std::min(bx + BlockSize, width), bottom = std::min(by + BlockSize, height);
+            for (int y = by; y < bottom; ++y) {
+                uint32_t* row = framebuffer.getRow(y);
+                const uint16_t* slotRow = slots.get() + size_t(y) * pitch;
+                // Most rows of an expanded block are still all single-valued; skip them 8 slots at a time.
+                uint64_t packed[2];
+                std::memcpy(packed, slotRow + bx, sizeof(packed));
+                if ((packed[0] & packed[1]) == ~uint64_t(0)) continue;
+                for (int x = bx; x < right; ++x) {
+                    if (slotRow[x] == Uniform) continue;
+                    const uint32_t* colors = getColors(tile, slotRow[x]);
+                    uint32_t red = 0, green = 0, blue = 0;
+                    for (int s = 0; s < sampleCount; ++s) {
+                        red += (colors[s] >> 16) & 0xFF;
+                        green += (colors[s] >> 8) & 0xFF;
+                        blue += colors[s] & 0xFF;
+                    }
+                    row[x] = ((red >> shift) << 16) | ((green >> shift) << 8) | (blue >> shift);
+                }
+            }
+        });
+    }
+
+    // Pixels currently holding samples, as of the last frame; call between frames.
+    size_t getExpandedPixelCount() const {
+        size_t count = 0;
+        for (const TilePool& pool : tiles) count += pool.used;
+        return count;
+    }
+
+private:
+    static constexpr int BlockSize = Framebuffer::CoarseBlockSize;
+
+    // Expanded pixels of one tile. used counts slots handed out since the last clear.
+    struct TilePool {
+        std::vector<uint32_t> colors;
+        std::vector<float> depths;
+        uint16_t used = 0;
+    };
+
+    int width, height, pitch;
+    int sampleCount;
+    int tileSize, tilesX;
+    int blocksX;
+    AlignedBuffer<uint16_t, Framebuffer::Alignment> slots;
+    std::vector<TilePool> tiles;
+    std::vector<uint8_t> expandedBlocks;
+
+    ScreenRect getTileRect(int tile) const {
+        int x = (tile % tilesX) * tileSize, y = (tile / tilesX) * tileSize;
+        return ScreenRect{ x, y, std::min(x + tileSize, width), std::min(y + tileSize, height) };
+    }
+
+    template <typename Visit>
+    void forEachExpandedBlock(const ScreenRect& rect, Visit visit) {
+        for (int by = rect.top; by < rect.bottom; by += BlockSize) {
+            for (int bx = rect.left; bx < rect.right; bx += BlockSize) {
+                if (expandedBlocks[size_t(by / BlockSize) * blocksX + bx / BlockSize]) visit(bx, by);
+            }
+        }
+    }
+};
@@ -0,0 +1,166 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <string>
+#include "Profiler.h"
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Identifies the pool worker running on this thread so submit() can push to its own deque.
+static thread_local const ThreadPool* currentPool = nullptr;
+static thread_local unsigned currentWorker = 0;
+
+static void PinCurrentThread(unsigned core) {
+#if defined(_WIN32)
+    if (core < sizeof(DWORD_PTR) * 8) {
+        SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << core);
+    }
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)core;
+#endif
+}
+
+ThreadPool::ThreadPool(unsigned workerCount, bool pinToCores) {
+    unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+    if (workerCount == AutoWorkerCount) {
+        workerCount = hardware - 1;
+    }
+
+    for (unsigned i = 0; i <= workerCount; ++i) {
+        queues.push_back(std::make_unique<TaskQueue>());
+    }
+    workers.reserve(workerCount);
+    for (unsigned i = 0; i < workerCount; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i, pinToCores);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    taskAvailable.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    unsigned target = currentPool == this ? currentWorker : (unsigned)workers.size();
+    pending.fetch_add(1);
+    queued.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(queues[target]->mutex);
+        queues[target]->tasks.push_back(std::move(task));
+    }
+
+    // Taking the sleep mutex orders this notify after a worker's predicate check.
+    bool wakeHelper;
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        wakeHelper = sleepingHelpers != 0;
+    }
+    taskAvailable.notify_one();
+    if (wakeHelper) helperWake.notify_all();
+}
+
+void ThreadPool::wait() {
+    while (pending.load() != 0) {
+        if (!runPendingTask()) {
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            // Nothing to steal: the remaining tasks are running on workers, and any
+            // they spawn will be picked up there.
+            tasksDone.wait(lock, [this]() { return pending.load() == 0; });
+        }
+    }
+}
+
+void ThreadPool::helpUntil(const std::function<bool()>& isDone) {
+    while (!isDone()) {
+        if (runPendingTask()) continue;
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        ++sleepingHelpers;
+        helperWake.wait(lock, [&]() { return queued.load() != 0 || isDone(); });
+        --sleepingHelpers;
+    }
+}
+
+void ThreadPool::wakeHelpers() {
+    { std::lock_guard<std::mutex> lock(sleepMutex); }
+    helperWake.notify_all();
+}
+
+bool ThreadPool::runPendingTask() {
+    std::function<void()> task;
+    unsigned self = currentPool == this ? currentWorker : (unsigned)workers.size();
+    if ((self < workers.size() && popLocal(self, task)) || steal(self, task)) {
+        execute(task);
+        return true;
+    }
+    return false;
+}
+
+bool ThreadPool::popLocal(unsigned index, std::function<void()>& task) {
+    TaskQueue& queue = *queues[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) return false;
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    queued.fetch_sub(1);
+    return true;
+}
+
+bool ThreadPool::steal(unsigned thief, std::function<void()>& task) {
+    size_t count = queues.size();
+    for (size_t offset = 1; offset <= count; ++offset) {
+        TaskQueue& queue = *queues[(thief + offset) % count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) continue;
+        task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+        queued.fetch_sub(1);
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::execute(std::function<void()>& task) {
+    task();
+    task = nullptr;
+    if (pending.fetch_sub(1) == 1) {
+        { std::lock_guard<std::mutex> lock(sleepMutex); }
+        tasksDone.notify_all();
+    }
+}
+
+void ThreadPool::workerLoop(unsigned index, bool pinToCore) {
+    currentPool = this;
+    currentWorker = index;
+    Profiler::setThreadName(("worker " + std::to_string(index + 1)).c_str());
+    if (pinToCore) {
+        unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+        PinCurrentThread((index + 1) % hardware);
+    }
+
+    std::function<void()> task;
+    while (true) {
+        if (popLocal(index, task) || steal(index, task)) {
+            execute(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        taskAvailable.wait(lock, [this]() { return stopping || queued.load() != 0; });
+        if (stopping && queued.load() == 0) return;
+    }
+}
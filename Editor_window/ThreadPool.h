@@ -0,0 +1,67 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent work-stealing worker pool owned by the engine. Every worker has
+// its own deque: it pushes and pops at the back (LIFO, cache-warm) while idle
+// workers steal from the front of the others. Tasks submitted from outside the
+// pool land in a shared injection queue that everyone steals from.
+class ThreadPool {
+public:
+    // Picks hardware_concurrency() - 1 workers so that workers plus the calling
+    // thread fill the machine.
+    static constexpr unsigned AutoWorkerCount = ~0u;
+
+    // workerCount == 0 runs everything on the calling thread. With pinToCores
+    // each worker is bound to its own core, starting at core 1 to leave core 0
+    // to the caller.
+    explicit ThreadPool(unsigned workerCount = AutoWorkerCount, bool pinToCores = false);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(std::function<void()> task);
+    // Blocks until every task passed to submit() has finished.
+    void wait();
+    // Steals and runs one queued task on the calling thread; false if none was found.
+    bool runPendingTask();
+    // Runs queued tasks on the calling thread until isDone() holds, sleeping
+    // while there is nothing to steal. Whatever makes isDone() true must call
+    // wakeHelpers() afterwards.
+    void helpUntil(const std::function<bool()>& isDone);
+    void wakeHelpers();
+
+    unsigned getWorkerCount() const { return (unsigned)workers.size(); }
+
+private:
+    struct TaskQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void workerLoop(unsigned index, bool pinToCore);
+    bool popLocal(unsigned index, std::function<void()>& task);
+    bool steal(unsigned thief, std::function<void()>& task);
+    void execute(std::function<void()>& task);
+
+    std::vector<std::thread> workers;
+    // One queue per worker followed by the injection queue for external submits.
+    std::vector<std::unique_ptr<TaskQueue>> queues;
+    std::atomic<size_t> queued{ 0 };
+    std::atomic<size_t> pending{ 0 };
+    std::mutex sleepMutex;
+    std::condition_variable taskAvailable;
+    std::condition_variable tasksDone;
+    // Threads sleeping in helpUntil(), woken by new tasks and by wakeHelpers().
+    std::condition_variable helperWake;
+    unsigned sleepingHelpers = 0;
+    bool stopping = false;
+};
@@ -0,0 +1,481 @@
+#include "VertexKernels.h"
+#include <atomic>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define ENGINE_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define ENGINE_TARGET(isa)
+#else
+#define ENGINE_TARGET(isa) __attribute__((target(isa)))
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define ENGINE_NEON 1
+#include <arm_neon.h>
+#endif
+
+// ---------------------------------------------------------------------------
+// Scalar reference kernels, also used for the tails of the vector loops.
+
+static void RotateScalar(const float* m, float* x, float* y, float* z, size_t begin, size_t count) {
+    for (size_t i = begin; i < count; ++i) {
+        float vx = x[i], vy = y[i], vz = z[i];
+        x[i] = m[0] * vx + m[1] * vy + m[2] * vz;
+        y[i] = m[3] * vx + m[4] * vy + m[5] * vz;
+        z[i] = m[6] * vx + m[7] * vy + m[8] * vz;
+    }
+}
+
+static void TransformScalar(const float* m, const float* x, const float* y, const float* z,
+    float* outX, float* outY, float* outZ, float* outW, size_t begin, size_t count) {
+    for (size_t i = begin; i < count; ++i) {
+        float vx = x[i], vy = y[i], vz = z[i];
+        float tx = m[0] * vx + m[1] * vy + m[2] * vz + m[3];
+        float ty = m[4] * vx + m[5] * vy + m[6] * vz + m[7];
+        float tz = m[8] * vx + m[9] * vy + m[10] * vz + m[11];
+        float tw = m[12] * vx + m[13] * vy + m[14] * vz + m[15];
+        outX[i] = tx; outY[i] = ty; outZ[i] = tz;
+        if (outW) outW[i] = tw;
+    }
+}
+
+static void ProjectScalar(const ProjectionParams& p, const float* x, const float* y, const float* z,
+    float* outX, float* outY, size_t begin, size_t count) {
+    float invFocal = 1.0f / p.focalLength;
+    for (size_t i = begin; i < count; ++i) {
+        float k = p.aspectRatio / (1.0f + z[i] * invFocal);
+        outX[i] = p.centerX + x[i] * k + p.offsetX;
+        outY[i] = p.centerY - y[i] * k + p.offsetY;
+    }
+}
+
+static void TransformProjectScalar(const float* m, const float* x, const float* y, const float* z,
+    float* outX, float* outY, float* outZ, float* outW, size_t begin, size_t count) {
+    for (size_t i = begin; i < count; ++i) {
+        float vx = x[i], vy = y[i], vz = z[i];
+        float tw = m[12] * vx + m[13] * vy + m[14] * vz + m[15];
+        float invW = 1.0f / tw;
+        if (outW) outW[i] = tw;
+        outX[i] = (m[0] * vx + m[1] * vy + m[2] * vz + m[3]) * invW;
+        outY[i] = (m[4] * vx + m[5] * vy + m[6] * vz + m[7]) * invW;
+        outZ[i] = (m[8] * vx + m[9] * vy + m[10] * vz + m[11]) * invW;
+    }
+}
+
+static void RotateScalar(const float* m, float* x, float* y, float* z, size_t count) {
+    RotateScalar(m, x, y, z, 0, count);
+}
+
+static void TransformScalar(const float* m, const float* x, const float* y, const float* z,
+    float* outX, float* outY, float* outZ, float* outW, size_t count) {
+    TransformScalar(m, x, y, z, outX, outY, outZ, outW, 0, count);
+}
+
+static void ProjectScalar(const ProjectionParams& p, const float* x, const float* y, const float* z,
+    float* outX, float* outY, size_t count) {
+    ProjectScalar(p, x, y, z, outX, outY, 0, count);
+}
+
+static void TransformProjectScalar(const float* m, const float* x, const float* y, const float* z,
+    float* outX, float* outY, float* outZ, float* outW, size_t count) {
+    TransformProjectScalar(m, x, y, z, outX, outY, outZ, outW, 0, count);
+}
+
+#if defined(ENGINE_X86)
+// ---------------------------------------------------------------------------
+// SSE: 4 vertices per instruction, SSE2 baseline only.
+
+static void RotateSSE(const float* m, float* x, float* y, float* z, size_t count) {
+    __m128 m0 = _mm_set1_ps(m[0]), m1 = _mm_set1_ps(m[1]), m2 = _mm_set1_ps(m[2]);
+    __m128 m3 = _mm_set1_ps(m[3]), m4 = _mm_set1_ps(m[4]), m5 = _mm_set1_ps(m[5]);
+    __m128 m6 = _mm_set1_ps(m[6]), m7 = _mm_set1_ps(m[7]), m8 = _mm_set1_ps(m[8]);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 vx = _mm_loadu_ps(x + i), vy = _mm_loadu_ps(y + i), vz = _mm_loadu_ps(z + i);
+        _mm_storeu_ps(x + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m0, vx), _mm_mul_ps(m1, vy)), _mm_mul_ps(m2, vz)));
+        _mm_storeu_ps(y + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m3, vx), _mm_mul_ps(m4, vy)), _mm_mul_ps(m5, vz)));
+        _mm_storeu_ps(z + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m6, vx), _mm_mul_ps(m7, vy)), _mm_mul_ps(m8, vz)));
+    }
+    RotateScalar(m, x, y, z, i, count);
+}
+
+static void TransformSSE(const float* m, const float* x, const float* y, const float* z,
+    float* outX, float* outY, float* outZ, float* outW, size_t count) {
+    __m128 r[16];
+    for (int k = 0; k < 16; ++k) r[k] = _mm_set1_ps(m[k]);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 vx = _mm_loadu_ps(x + i), vy = _mm_loadu_ps(y + i), vz = _mm_loadu_ps(z + i);
+        __m128 tx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r[0], vx), _mm_mul_ps(r[1], vy)), _mm_add_ps(_mm_mul_ps(r[2], vz), r[3]));
+        __m128 ty = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r[4], vx), _mm_mul_ps(r[5], vy)), _mm_add_ps(_mm_mul_ps(r[6], vz), r[7]));
+        __m128 tz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r[8], vx), _mm_mul_ps(r[9], vy)), _mm_add_ps(_mm_mul_ps(r[10], vz), r[11]));
+        __m128 tw = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r[12], vx), _mm_mul_ps(r[13], vy)), _mm_add_ps(_mm_mul_ps(r[14], vz), r[15]));
+        _mm_storeu_ps(outX + i, tx);
+        _mm_storeu_ps(outY + i, ty);
+        _mm_storeu_ps(outZ + i, tz);
+        if (outW) _mm_storeu_ps(outW + i, tw);
+    }
+    TransformScalar(m, x, y, z, outX, outY, outZ, outW, i, count);
+}
+
+static void ProjectSSE(const ProjectionParams& p, const float* x, const float* y, const float* z,
+    float* outX, float* outY, size_t count) {
+    __m128 one = _mm_set1_ps(1.0f), invFocal = _mm_set1_ps(1.0f / p.focalLength), aspect = _mm_set1_ps(p.aspectRatio);
+    __m128 baseX = _mm_set1_ps(p.centerX + p.offsetX), baseY = _mm_set1_ps(p.centerY + p.offsetY);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 k = _mm_div_ps(aspect, _mm_add_ps(one, _mm_mul_ps(_mm_loadu_ps(z + i), invFocal)));
+        _mm_storeu_ps(outX + i, _mm_add_ps(baseX, _mm_mul_ps(_mm_loadu_ps(x + i), k)));
+        _mm_storeu_ps(outY + i, _mm_sub_ps(baseY, _mm_mul_ps(_mm_loadu_ps(y + i), k)));
+    }
+    ProjectScalar(p, x, y, z, outX, outY, i, count);
+}
+
+static void TransformProjectSSE(const float* m, const float* x, const float* y, const float* z,
+    float* outX, float* outY, float* outZ, float* outW, size_t count) {
+    __m128 r[16];
+    for (int k = 0; k < 16; ++k) r[k] = _mm_set1_ps(m[k]);
+    __m128 one = _mm_set1_ps(1.0f);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 vx = _mm_loadu_ps(x + i), vy = _mm_loadu_ps(y + i), vz = _mm_loadu_ps(z + i);
+        __m128 tw = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r[12], vx), _mm_mul_ps(r[13], vy)), _mm_add_ps(_mm_mul_ps(r[14], vz), r[15]));
+        __m128 invW = _mm_div_ps(one, tw);
+        __m128 tx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r[0], vx), _mm_mul_ps(r[1], vy)), _mm_add_ps(_mm_mul_ps(r[2], vz), r[3]));
+        __m128 ty = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r[4], vx), _mm_mul_ps(r[5], vy)), _mm_add_ps(_mm_mul_ps(r[6], vz), r[7]));
+        __m128 tz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r[8], vx), _mm_mul_ps(r[9], vy)), _mm_add_ps(_mm_mul_ps(r[10], vz), r[11]));
+        _mm_storeu_ps(outX + i, _mm_mul_ps(tx, invW));
+        _mm_storeu_ps(outY + i, _mm_mul_ps(ty, invW));
+        _mm_storeu_ps(outZ + i, _mm_mul_ps(tz, invW));
+        if (outW) _mm_storeu_ps(outW + i, tw);
+    }
+    TransformProjectScalar(m, x, y, z, outX, outY, outZ, outW, i, count);
+}
+
+// ---------------------------------------------------------------------------
+// AVX2 + FMA: 8 vertices per instruction.
+
+ENGINE_TARGET("avx2,fma")
+static void RotateAVX2(const float* m, float* x, float* y, float* z, size_t count) {
+    __m256 m0 = _mm256_set1_ps(m[0]), m1 = _mm256_set1_ps(m[1]), m2 = _mm256_set1_ps(m[2]);
+    __m256 m3 = _mm256_set1_ps(m[3]), m4 = _mm256_set1_ps(m[4]), m5 = _mm256_set1_ps(m[5]);
+    __m256 m6 = _mm256_set1_ps(m[6]), m7 = _mm256_set1_ps(m[7]), m8 = _mm256_set1_ps(m[8]);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 vx = _mm256_loadu_ps(x + i), vy = _mm256_loadu_ps(y + i), vz = _mm256_loadu_ps(z + i);
+        _mm256_storeu_ps(x + i, _mm256_fmadd_ps(m2, vz, _mm256_fmadd_ps(m1, vy, _mm256_mul_ps(m0, vx))));
+        _mm256_storeu_ps(y + i, _mm256_fmadd_ps(m5, vz, _mm256_fmadd_ps(m4, vy, _mm256_mul_ps(m3, vx))));
+        _mm256_storeu_ps(z + i, _mm256_fmadd_ps(m8, vz, _mm256_fmadd_ps(m7, vy, _mm256_mul_ps(m6, vx))));
+    }
+    RotateScalar(m, x, y, z, i, count);
+}
+
+ENGINE_TARGET("avx2,fma")
+static void TransformAVX2(const float* m, const float* x, const float* y, const float* z,
+    float* outX, float* outY, float* outZ, float* outW, size_t count) {
+    __m256 r[16];
+    for (int k = 0; k < 16; ++k) r[k] = _mm256_set1_ps(m[k]);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 vx = _mm256_loadu_ps(x + i), vy = _mm256_loadu_ps(y + i), vz = _mm256_loadu_ps(z + i);
+        __m256 tx = _mm256_fmadd_ps(r[0], vx, _mm256_fmadd_ps(r[1], vy, _mm256_fmadd_ps(r[2], vz, r[3])));
+        __m256 ty = _mm256_fmadd_ps(r[4], vx, _mm256_fmadd_ps(r[5], vy, _mm256_fmadd_ps(r[6], vz, r[7])));
+        __m256 tz = _mm256_fmadd_ps(r[8], vx, _mm256_fmadd_ps(r[9], vy, _mm256_fmadd_ps(r[10], vz, r[11])));
+        __m256 tw = _mm256_fmadd_ps(r[12], vx, _mm256_fmadd_ps(r[13], vy, _mm256_fmadd_ps(r[14], vz, r[15])));
+        _mm256_storeu_ps(outX + i, tx);
+        _mm256_storeu_ps(outY + i, ty);
+        _mm256_storeu_ps(outZ + i, tz);
+        if (outW) _mm256_storeu_ps(outW + i, tw);
+    }
+    TransformScalar(m, x, y, z, outX, outY, outZ, outW, i, count);
+}
+
+ENGINE_TARGET("avx2,fma")
+static void ProjectAVX2(const ProjectionParams& p, const float* x, const float* y, const float* z,
+    float* outX, float* outY, size_t count) {
+    __m256 one = _mm256_set1_ps(1.0f), invFocal = _mm256_set1_ps(1.0f / p.focalLength), aspect = _mm256_set1_ps(p.aspectRatio);
+    __m256 baseX = _mm256_set1_ps(p.centerX + p.offsetX), baseY = _mm256_set1_ps(p.centerY + p.offsetY);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 k = _mm256_div_ps(aspect, _mm256_fmadd_ps(_mm256_loadu_ps(z + i), invFocal, one));
+        _mm256_storeu_ps(outX + i, _mm256_fmadd_ps(_mm256_loadu_ps(x + i), k, baseX));
+        _mm256_storeu_ps(outY + i, _mm256_fnmadd_ps(_mm256_loadu_ps(y + i), k, baseY));
+    }
+    ProjectScalar(p, x, y, z, outX, outY, i, count);
+}
+
+ENGINE_TARGET("avx2,fma")
+static void TransformProjectAVX2(const float* m, const float* x, const float* y, const float* z,
+    float* outX, float* outY, float* outZ, float* outW, size_t count) {
+    __m256 r[16];
+    for (int k = 0; k < 16; ++k) r[k] = _mm256_set1_ps(m[k]);
+    __m256 one = _mm256_set1_ps(1.0f);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 vx = _mm256_loadu_ps(x + i), vy = _mm256_loadu_ps(y + i), vz = _mm256_loadu_ps(z + i);
+        __m256 tw = _mm256_fmadd_ps(r[12], vx, _mm256_fmadd_ps(r[13], vy, _mm256_fmadd_ps(r[14], vz, r[15])));
+        __m256 invW = _mm256_div_ps(one, tw);
+        __m256 tx = _mm256_fmadd_ps(r[0], vx, _mm256_fmadd_ps(r[1], vy, _mm256_fmadd_ps(r[2], vz, r[3])));
+        __m256 ty = _mm256_fmadd_ps(r[4], vx, _mm256_fmadd_ps(r[5], vy, _mm256_fmadd_ps(r[6], vz, r[7])));
+        __m256 tz = _mm256_fmadd_ps(r[8], vx, _mm256_fmadd_ps(r[9], vy, _mm256_fmadd_ps(r[10], vz, r[11])));
+        _mm256_storeu_ps(outX + i, _mm256_mul_ps(tx, invW));
+        _mm256_storeu_ps(outY + i, _mm256_mul_ps(ty, invW));
+        _mm256_storeu_ps(outZ + i, _mm256_mul_ps(tz, invW));
+        if (outW) _mm256_storeu_ps(outW + i, tw);
+    }
+    TransformProjectScalar(m, x, y, z, outX, outY, outZ, outW, i, count);
+}
+
+// ---------------------------------------------------------------------------
+// AVX-512F: 16 vertices per instruction.
+
+ENGINE_TARGET("avx512f")
+static void RotateAVX512(const float* m, float* x, float* y, float* z, size_t count) {
+    __m512 m0 = _mm512_set1_ps(m[0]), m1 = _mm512_set1_ps(m[1]), m2 = _mm512_set1_ps(m[2]);
+    __m512 m3 = _mm512_set1_ps(m[3]), m4 = _mm512_set1_ps(m[4]), m5 = _mm512_set1_ps(m[5]);
+    __m512 m6 = _mm512_set1_ps(m[6]), m7 = _mm512_set1_ps(m[7]), m8 = _mm512_set1_ps(m[8]);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m512 vx = _mm512_loadu_ps(x + i), vy = _mm512_loadu_ps(y + i), vz = _mm512_loadu_ps(z + i);
+        _mm512_storeu_ps(x + i, _mm512_fmadd_ps(m2, vz, _mm512_fmadd_ps(m1, vy, _mm512_mul_ps(m0, vx))));
+        _mm512_storeu_ps(y + i, _mm512_fmadd_ps(m5, vz, _mm512_fmadd_ps(m4, vy, _mm512_mul_ps(m3, vx))));
+        _mm512_storeu_ps(z + i, _mm512_fmadd_ps(m8, vz, _mm512_fmadd_ps(m7, vy, _mm512_mul_ps(m6, vx))));
+    }
+    RotateScalar(m, x, y, z, i, count);
+}
+
+ENGINE_TARGET("avx512f")
+static void TransformAVX512(const float* m, const float* x, const float* y, const float* z,
+    float* outX, float* outY, float* outZ, float* outW, size_t count) {
+    __m512 r[16];
+    for (int k = 0; k < 16; ++k) r[k] = _mm512_set1_ps(m[k]);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m512 vx = _mm512_loadu_ps(x + i), vy = _mm512_loadu_ps(y + i), vz = _mm512_loadu_ps(z + i);
+        __m512 tx = _mm512_fmadd_ps(r[0], vx, _mm512_fmadd_ps(r[1], vy, _mm512_fmadd_ps(r[2], vz, r[3])));
+        __m512 ty = _mm512_fmadd_ps(r[4], vx, _mm512_fmadd_ps(r[5], vy, _mm512_fmadd_ps(r[6], vz, r[7])));
+        __m512 tz = _mm512_fmadd_ps(r[8], vx, _mm512_fmadd_ps(r[9], vy, _mm512_fmadd_ps(r[10], vz, r[11])));
+        __m512 tw = _mm512_fmadd_ps(r[12], vx, _mm512_fmadd_ps(r[13], vy, _mm512_fmadd_ps(r[14], vz, r[15])));
+        _mm512_storeu_ps(outX + i, tx);
+        _mm512_storeu_ps(outY + i, ty);
+        _mm512_storeu_ps(outZ + i, tz);
+        if (outW) _mm512_storeu_ps(outW + i, tw);
+    }
+    TransformScalar(m, x, y, z, outX, outY, outZ, outW, i, count);
+}
+
+ENGINE_TARGET("avx512f")
+static void ProjectAVX512(const ProjectionParams& p, const float* x, const float* y, const float* z,
+    float* outX, float* outY, size_t count) {
+    __m512 one = _mm512_set1_ps(1.0f), invFocal = _mm512_set1_ps(1.0f / p.focalLength), aspect = _mm512_set1_ps(p.aspectRatio);
+    __m512 baseX = _mm512_set1_ps(p.centerX + p.offsetX), baseY = _mm512_set1_ps(p.centerY + p.offsetY);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m512 k = _mm512_div_ps(aspect, _mm512_fmadd_ps(_mm512_loadu_ps(z + i), invFocal, one));
+        _mm512_storeu_ps(outX + i, _mm512_fmadd_ps(_mm512_loadu_ps(x + i), k, baseX));
+        _mm512_storeu_ps(outY + i, _mm512_fnmadd_ps(_mm512_loadu_ps(y + i), k, baseY));
+    }
+    ProjectScalar(p, x, y, z, outX, outY, i, count);
+}
+
+ENGINE_TARGET("avx512f")
+static void TransformProjectAVX512(const float* m, const float* x, const float* y, const float* z,
+    float* outX, float* outY, float* outZ, float* outW, size_t count) {
+    __m512 r[16];
+    for (int k = 0; k < 16; ++k) r[k] = _mm512_set1_ps(m[k]);
+    __m512 one = _mm512_set1_ps(1.0f);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m512 vx = _mm512_loadu_ps(x + i), vy = _mm512_loadu_ps(y + i), vz = _mm512_loadu_ps(z + i);
+        __m512 tw = _mm512_fmadd_ps(r[12], vx, _mm512_fmadd_ps(r[13], vy, _mm512_fmadd_ps(r[14], vz, r[15])));
+        __m512 invW = _mm512_div_ps(one, tw);
+        __m512 tx = _mm512_fmadd_ps(r[0], vx, _mm512_fmadd_ps(r[1], vy, _mm512_fmadd_ps(r[2], vz, r[3])));
+        __m512 ty = _mm512_fmadd_ps(r[4], vx, _mm512_fmadd_ps(r[5], vy, _mm512_fmadd_ps(r[6], vz, r[7])));
+        __m512 tz = _mm512_fmadd_ps(r[8], vx, _mm512_fmadd_ps(r[9], vy, _mm512_fmadd_ps(r[10], vz, r[11])));
+        _mm512_storeu_ps(outX + i, _mm512_mul_ps(tx, invW));
+        _mm512_storeu_ps(outY + i, _mm512_mul_ps(ty, invW));
+        _mm512_storeu_ps(outZ + i, _mm512_mul_ps(tz, invW));
+        if (outW) _mm512_storeu_ps(outW + i, tw);
+    }
+    TransformProjectScalar(m, x, y, z, outX, outY, outZ, outW, i, count);
+}
+#endif
+
+#if defined(ENGINE_NEON)
+// ---------------------------------------------------------------------------
+// NEON: 4 vertices per instruction.
+
+static void RotateNEON(const float* m, float* x, float* y, float* z, size_t count) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t vx = vld1q_f32(x + i), vy = vld1q_f32(y + i), vz = vld1q_f32(z + i);
+        vst1q_f32(x + i, vfmaq_n_f32(vfmaq_n_f32(vmulq_n_f32(vx, m[0]), vy, m[1]), vz, m[2]));
+        vst1q_f32(y + i, vfmaq_n_f32(vfmaq_n_f32(vmulq_n_f32(vx, m[3]), vy, m[4]), vz, m[5]));
+        vst1q_f32(z + i, vfmaq_n_f32(vfmaq_n_f32(vmulq_n_f32(vx, m[6]), vy, m[7]), vz, m[8]));
+    }
+    RotateScalar(m, x, y, z, i, count);
+}
+
+static void TransformNEON(const float* m, const float* x, const float* y, const float* z,
+    float* outX, float* outY, float* outZ, float* outW, size_t count) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t vx = vld1q_f32(x + i), vy = vld1q_f32(y + i), vz = vld1q_f32(z + i);
+        float32x4_t tx = vfmaq_n_f32(vfmaq_n_f32(vfmaq_n_f32(vdupq_n_f32(m[3]), vx, m[0]), vy, m[1]), vz, m[2]);
+        float32x4_t ty = vfmaq_n_f32(vfmaq_n_f32(vfmaq_n_f32(vdupq_n_f32(m[7]), vx, m[4]), vy, m[5]), vz, m[6]);
+        float32x4_t tz = vfmaq_n_f32(vfmaq_n_f32(vfmaq_n_f32(vdupq_n_f32(m[11]), vx, m[8]), vy, m[9]), vz, m[10]);
+        float32x4_t tw = vfmaq_n_f32(vfmaq_n_f32(vfmaq_n_f32(vdupq_n_f32(m[15]), vx, m[12]), vy, m[13]), vz, m[14]);
+        vst1q_f32(outX + i, tx);
+        vst1q_f32(outY + i, ty);
+        vst1q_f32(outZ + i, tz);
+        if (outW) vst1q_f32(outW + i, tw);
+    }
+    TransformScalar(m, x, y, z, outX, outY, outZ, outW, i, count);
+}
+
+static void ProjectNEON(const ProjectionParams& p, const float* x, const float* y, const float* z,
+    float* outX, float* outY, size_t count) {
+    float32x4_t one = vdupq_n_f32(1.0f), aspect = vdupq_n_f32(p.aspectRatio);
+    float32x4_t baseX = vdupq_n_f32(p.centerX + p.offsetX), baseY = vdupq_n_f32(p.centerY + p.offsetY);
+    float invFocal = 1.0f / p.focalLength;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t k = vdivq_f32(aspect, vfmaq_n_f32(one, vld1q_f32(z + i), invFocal));
+        vst1q_f32(outX + i, vfmaq_f32(baseX, vld1q_f32(x + i), k));
+        vst1q_f32(outY + i, vfmsq_f32(baseY, vld1q_f32(y + i), k));
+    }
+    ProjectScalar(p, x, y, z, outX, outY, i, count);
+}
+
+static void TransformProjectNEON(const float* m, const float* x, const float* y, const float* z,
+    float* outX, float* outY, float* outZ, float* outW, size_t count) {
+    float32x4_t one = vdupq_n_f32(1.0f);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t vx = vld1q_f32(x + i), vy = vld1q_f32(y + i), vz = vld1q_f32(z + i);
+        float32x4_t tw = vfmaq_n_f32(vfmaq_n_f32(vfmaq_n_f32(vdupq_n_f32(m[15]), vx, m[12]), vy, m[13]), vz, m[14]);
+        float32x4_t invW = vdivq_f32(one, tw);
+        float32x4_t tx = vfmaq_n_f32(vfmaq_n_f32(vfmaq_n_f32(vdupq_n_f32(m[3]), vx, m[0]), vy, m[1]), vz, m[2]);
+        float32x4_t ty = vfmaq_n_f32(vfmaq_n_f32(vfmaq_n_f32(vdupq_n_f32(m[7]), vx, m[4]), vy, m[5]), vz, m[6]);
+        float32x4_t tz = vfmaq_n_f32(vfmaq_n_f32(vfmaq_n_f32(vdupq_n_f32(m[11]), vx, m[8]), vy, m[9]), vz, m[10]);
+        vst1q_f32(outX + i, vmulq_f32(tx, invW));
+        vst1q_f32(outY + i, vmulq_f32(ty, invW));
+        vst1q_f32(outZ + i, vmulq_f32(tz, invW));
+        if (outW) vst1q_f32(outW + i, tw);
+    }
+    TransformProjectScalar(m, x, y, z, outX, outY, outZ, outW, i, count);
+}
+#endif
+
+// ---------------------------------------------------------------------------
+// Dispatch
+
+static const VertexKernels ScalarKernels = { SimdLevel::Scalar, RotateScalar, TransformScalar, ProjectScalar, TransformProjectScalar };
+#if defined(ENGINE_X86)
+static const VertexKernels SSEKernels = { SimdLevel::SSE, RotateSSE, TransformSSE, ProjectSSE, TransformProjectSSE };
+static const VertexKernels AVX2Kernels = { SimdLevel::AVX2, RotateAVX2, TransformAVX2, ProjectAVX2, TransformProjectAVX2 };
+static const VertexKernels AVX512Kernels = { SimdLevel::AVX512, RotateAVX512, TransformAVX512, ProjectAVX512, TransformProjectAVX512 };
+#endif
+#if defined(ENGINE_NEON)
+static const VertexKernels NEONKernels = { SimdLevel::NEON, RotateNEON, TransformNEON, ProjectNEON, TransformProjectNEON };
+#endif
+
+#if defined(ENGINE_X86)
+static bool CpuHasAVX2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool fma = (info[2] & (1 << 12)) != 0;
+    if (!osxsave || !fma || (_xgetbv(0) & 0x6) != 0x6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+
+static bool CpuHasAVX512() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 1);
+    if (!(info[2] & (1 << 27)) || (_xgetbv(0) & 0xE6) != 0xE6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 16)) != 0;
+#else
+    return __builtin_cpu_supports("avx512f");
+#endif
+}
+#endif
+
+bool IsSimdLevelSupported(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::Scalar:
+        return true;
+#if defined(ENGINE_X86)
+    case SimdLevel::SSE:
+        return true;
+    case SimdLevel::AVX2:
+        return CpuHasAVX2();
+    case SimdLevel::AVX512:
+        return CpuHasAVX512();
+#endif
+#if defined(ENGINE_NEON)
+    case SimdLevel::NEON:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+SimdLevel DetectSimdLevel() {
+    const SimdLevel preferred[] = { SimdLevel::AVX512, SimdLevel::AVX2, SimdLevel::SSE, SimdLevel::NEON };
+    for (SimdLevel level : preferred) {
+        if (IsSimdLevelSupported(level)) return level;
+    }
+    return SimdLevel::Scalar;
+}
+
+const char* GetSimdLevelName(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::Scalar: return "scalar";
+    case SimdLevel::SSE: return "sse";
+    case SimdLevel::AVX2: return "avx2";
+    case SimdLevel::AVX512: return "avx512";
+    case SimdLevel::NEON: return "neon";
+    }
+    return "unknown";
+}
+
+const VertexKernels& GetVertexKernels(SimdLevel level) {
+    switch (level) {
+#if defined(ENGINE_X86)
+    case SimdLevel::SSE: return SSEKernels;
+    case SimdLevel::AVX2: return AVX2Kernels;
+    case SimdLevel::AVX512: return AVX512Kernels;
+#endif
+#if defined(ENGINE_NEON)
+    case SimdLevel::NEON: return NEONKernels;
+#endif
+    default: return ScalarKernels;
+    }
+}
+
+static std::atomic<const VertexKernels*> activeKernels{ nullptr };
+
+const VertexKernels& GetVertexKernels() {
+    const VertexKernels* kernels = activeKernels.load(std::memory_order_acquire);
+    if (!kernels) {
+        kernels = &GetVertexKernels(DetectSimdLevel());
+        activeKernels.store(kernels, std::memory_order_release);
+    }
+    return *kernels;
+}
+
+bool SetSimdLevel(SimdLevel level) {
+    if (!IsSimdLevelSupported(level)) return false;
+    activeKernels.store(&GetVertexKernels(level), std::memory_order_release);
+    return true;
+}
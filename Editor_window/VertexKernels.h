@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include "MathTypes.h"
+
+enum class SimdLevel {
+    Scalar,
+    SSE,
+    AVX2,
+    AVX512,
+    NEON,
+};
+
+// Kernels over SoA float streams. Each handles any count; the vector loop covers
+// whole registers and a scalar loop finishes the tail. Matrices are row-major.
+struct VertexKernels {
+    SimdLevel level;
+    // In place: (x, y, z) = m3x3 * (x, y, z).
+    void (*rotate)(const float* m3x3, float* x, float* y, float* z, size_t count);
+    // (outX, outY, outZ, outW) = m4x4 * (x, y, z, 1). Output may alias input.
+    void (*transform)(const float* m4x4, const float* x, const float* y, const float* z,
+        float* outX, float* outY, float* outZ, float* outW, size_t count);
+    void (*project)(const ProjectionParams& params, const float* x, const float* y, const float* z,
+        float* outX, float* outY, size_t count);
+    // (outX, outY, outZ) = (m4x4 * (x, y, z, 1)).xyz / w, with one reciprocal per
+    // vertex. w itself is written to outW unless it is null.
+    void (*transformProject)(const float* m4x4, const float* x, const float* y, const float* z,
+        float* outX, float* outY, float* outZ, float* outW, size_t count);
+};
+
+SimdLevel DetectSimdLevel();
+bool IsSimdLevelSupported(SimdLevel level);
+const char* GetSimdLevelName(SimdLevel level);
+
+// Kernels for the active level, which defaults to DetectSimdLevel().
+const VertexKernels& GetVertexKernels();
+const VertexKernels& GetVertexKernels(SimdLevel level);
+// Overrides the active level, e.g. to measure what each ISA buys. Fails if the CPU lacks it.
+bool SetSimdLevel(SimdLevel level);
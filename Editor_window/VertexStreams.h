@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include "AlignedBuffer.h"
+
+// Structure-of-arrays vertex positions: one aligned float stream per axis so
+// SIMD kernels load 4/8/16 consecutive vertices per instruction. Streams are
+// padded with zeros to a whole number of the widest vector.
+struct VertexStreams {
+    static constexpr size_t Alignment = 64;
+    static constexpr size_t Lanes = Alignment / sizeof(float);
+
+    AlignedBuffer<float, Alignment> x, y, z;
+    size_t count = 0;
+
+    void resize(size_t newCount) {
+        size_t padded = getPaddedSize(newCount);
+        if (padded != x.size()) {
+            x.allocate(padded);
+            y.allocate(padded);
+            z.allocate(padded);
+        }
+        count = newCount;
+        if (padded) {
+            std::memset(x.get(), 0, padded * sizeof(float));
+            std::memset(y.get(), 0, padded * sizeof(float));
+            std::memset(z.get(), 0, padded * sizeof(float));
+        }
+    }
+
+    size_t size() const { return count; }
+    size_t getPaddedSize() const { return x.size(); }
+
+    static size_t getPaddedSize(size_t n) {
+        return (n + Lanes - 1) / Lanes * Lanes;
+    }
+};